@@ -0,0 +1,792 @@
+#include <stdlib.h> // malloc, aligned_alloc, atoi, rand
+#include <stdio.h>
+#include <string.h> // memmove, memcpy
+#include <time.h>	// time
+
+#define ORDER 64			 // maximum number of keys in a node (keys fill four cache lines)
+#define MIN_KEYS (ORDER / 2) // minimum number of keys in a non-root node
+#define CACHE_LINE 64
+#define MAX_HEIGHT 32 // far above the height of any tree that fits in memory
+
+////////////////////////////////////////////////////////////////////////////////
+// BPTREE type definition
+// every node starts with its sorted keys so that a whole node is compared at once;
+// nodes are allocated on cache line boundaries (sizes are padded to multiples of CACHE_LINE)
+typedef struct
+{
+	_Alignas(CACHE_LINE) int keys[ORDER];
+	int nKeys;
+	int leaf; // 1 if leaf; 0 if internal
+} NODE;
+
+// internal node: keys[i] is the smallest key in children[i + 1]
+typedef struct
+{
+	NODE hdr;
+	NODE *children[ORDER + 1];
+} INNER;
+
+// leaf node: each key is stored once with its number of occurrences
+typedef struct leaf
+{
+	NODE hdr;
+	int counts[ORDER];
+	struct leaf *next; // right sibling for ordered scans
+} LEAF;
+
+typedef struct
+{
+	NODE *root;
+	int count; // number of keys including duplicates
+} BPTREE;
+
+// new nodes allocated by BPT_Insert before a split changes anything
+typedef struct
+{
+	LEAF *leaf;
+	INNER *inners[MAX_HEIGHT];
+	int nInners;
+} SPARE;
+
+// range scan position
+typedef struct
+{
+	LEAF *leaf;
+	int pos;  // index in leaf
+	int dup;  // occurrences of keys[pos] already returned
+	int last; // upper bound of the range (inclusive)
+} BPT_CURSOR;
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototype declarations
+
+/* Allocates dynamic memory for a tree head node and returns its address to caller
+	return	head node pointer
+			NULL if overflow
+*/
+BPTREE *BPT_Create(void)
+{
+	BPTREE *temp = (BPTREE *)malloc(sizeof(BPTREE));
+	if (temp == NULL)
+		return NULL;
+
+	temp->root = NULL;
+	temp->count = 0;
+
+	return temp;
+}
+
+/* internal function
+*/
+static void _destroy(NODE *root)
+{
+	if (root == NULL)
+		return;
+
+	if (!root->leaf)
+	{
+		INNER *inner = (INNER *)root;
+
+		for (int i = 0; i <= root->nKeys; i++)
+			_destroy(inner->children[i]);
+	}
+
+	free(root);
+}
+
+/* Deletes all data in tree and recycles memory
+*/
+void BPT_Destroy(BPTREE *pTree)
+{
+	_destroy(pTree->root);
+
+	free(pTree);
+}
+
+static LEAF *_makeLeaf(void)
+{
+	LEAF *temp = (LEAF *)aligned_alloc(CACHE_LINE, sizeof(LEAF));
+	if (temp == NULL)
+		return NULL;
+
+	temp->hdr.nKeys = 0;
+	temp->hdr.leaf = 1;
+	temp->next = NULL;
+
+	return temp;
+}
+
+static INNER *_makeInner(void)
+{
+	INNER *temp = (INNER *)aligned_alloc(CACHE_LINE, sizeof(INNER));
+	if (temp == NULL)
+		return NULL;
+
+	temp->hdr.nKeys = 0;
+	temp->hdr.leaf = 0;
+
+	return temp;
+}
+
+/* internal function
+	Compares key with every key of the node without branching
+	(the loop is vectorized by the compiler)
+	return	number of keys less than key
+*/
+static int _lowerBound(NODE *node, int key)
+{
+	int pos = 0;
+
+	for (int i = 0; i < node->nKeys; i++)
+		pos += node->keys[i] < key;
+
+	return pos;
+}
+
+/* internal function
+	return	number of keys less than or equal to key
+*/
+static int _upperBound(NODE *node, int key)
+{
+	int pos = 0;
+
+	for (int i = 0; i < node->nKeys; i++)
+		pos += node->keys[i] <= key;
+
+	return pos;
+}
+
+/* internal function
+	Inserts key into a full leaf by splitting it into leaf and right (a new leaf)
+*/
+static void _splitLeaf(LEAF *leaf, LEAF *right, int pos, int key)
+{
+	int keys[ORDER + 1], counts[ORDER + 1];
+
+	memcpy(keys, leaf->hdr.keys, pos * sizeof(int));
+	memcpy(counts, leaf->counts, pos * sizeof(int));
+	keys[pos] = key;
+	counts[pos] = 1;
+	memcpy(keys + pos + 1, leaf->hdr.keys + pos, (ORDER - pos) * sizeof(int));
+	memcpy(counts + pos + 1, leaf->counts + pos, (ORDER - pos) * sizeof(int));
+
+	int half = (ORDER + 1) / 2;
+
+	memcpy(leaf->hdr.keys, keys, half * sizeof(int));
+	memcpy(leaf->counts, counts, half * sizeof(int));
+	leaf->hdr.nKeys = half;
+
+	memcpy(right->hdr.keys, keys + half, (ORDER + 1 - half) * sizeof(int));
+	memcpy(right->counts, counts + half, (ORDER + 1 - half) * sizeof(int));
+	right->hdr.nKeys = ORDER + 1 - half;
+
+	right->next = leaf->next;
+	leaf->next = right;
+}
+
+/* internal function
+	Inserts separator key and its right child into a full internal node
+	by splitting it into inner and right (a new internal node)
+	promoted receives the separator moved up to the parent
+*/
+static void _splitInner(INNER *inner, INNER *right, int pos, int key, NODE *child, int *promoted)
+{
+	int keys[ORDER + 1];
+	NODE *children[ORDER + 2];
+
+	memcpy(keys, inner->hdr.keys, pos * sizeof(int));
+	keys[pos] = key;
+	memcpy(keys + pos + 1, inner->hdr.keys + pos, (ORDER - pos) * sizeof(int));
+
+	memcpy(children, inner->children, (pos + 1) * sizeof(NODE *));
+	children[pos + 1] = child;
+	memcpy(children + pos + 2, inner->children + pos + 1, (ORDER - pos) * sizeof(NODE *));
+
+	int half = ORDER / 2;
+
+	memcpy(inner->hdr.keys, keys, half * sizeof(int));
+	memcpy(inner->children, children, (half + 1) * sizeof(NODE *));
+	inner->hdr.nKeys = half;
+
+	*promoted = keys[half];
+
+	memcpy(right->hdr.keys, keys + half + 1, (ORDER - half) * sizeof(int));
+	memcpy(right->children, children + half + 1, (ORDER - half + 1) * sizeof(NODE *));
+	right->hdr.nKeys = ORDER - half;
+}
+
+/* internal function
+	This function uses recursion to insert the key into a leaf node
+	new siblings of split nodes are taken from spare, so nothing can fail here
+	split receives the new right sibling if the node was split (NULL if not)
+	promoted receives the smallest key of the new sibling
+*/
+static void _insert(NODE *root, int key, SPARE *spare, NODE **split, int *promoted)
+{
+	*split = NULL;
+
+	if (root->leaf)
+	{
+		LEAF *leaf = (LEAF *)root;
+		int pos = _lowerBound(root, key);
+
+		if (pos < root->nKeys && root->keys[pos] == key)
+		{
+			leaf->counts[pos]++;
+			return;
+		}
+
+		if (root->nKeys < ORDER)
+		{
+			memmove(root->keys + pos + 1, root->keys + pos, (root->nKeys - pos) * sizeof(int));
+			memmove(leaf->counts + pos + 1, leaf->counts + pos, (root->nKeys - pos) * sizeof(int));
+			root->keys[pos] = key;
+			leaf->counts[pos] = 1;
+			root->nKeys++;
+			return;
+		}
+
+		LEAF *right = spare->leaf;
+		_splitLeaf(leaf, right, pos, key);
+
+		*split = (NODE *)right;
+		*promoted = right->hdr.keys[0];
+		return;
+	}
+
+	INNER *inner = (INNER *)root;
+	int pos = _upperBound(root, key);
+	NODE *child;
+	int childKey;
+
+	_insert(inner->children[pos], key, spare, &child, &childKey);
+
+	if (child == NULL)
+		return;
+
+	if (root->nKeys < ORDER)
+	{
+		memmove(root->keys + pos + 1, root->keys + pos, (root->nKeys - pos) * sizeof(int));
+		memmove(inner->children + pos + 2, inner->children + pos + 1, (root->nKeys - pos) * sizeof(NODE *));
+		root->keys[pos] = childKey;
+		inner->children[pos + 1] = child;
+		root->nKeys++;
+		return;
+	}
+
+	INNER *right = spare->inners[--(spare->nInners)];
+	_splitInner(inner, right, pos, childKey, child, promoted);
+
+	*split = (NODE *)right;
+}
+
+/* internal function
+	Allocates the new nodes needed to insert key:
+	the nodes split are the full ones at the bottom of the search path,
+	and a new root is needed if the whole path is full
+	return	1 success
+			0 overflow (nothing allocated)
+*/
+static int _reserve(NODE *root, int key, SPARE *spare)
+{
+	int depth = 1, run = 0; // run: full internal nodes right above the current node
+
+	spare->leaf = NULL;
+	spare->nInners = 0;
+
+	while (!root->leaf)
+	{
+		run = (root->nKeys == ORDER) ? run + 1 : 0;
+		root = ((INNER *)root)->children[_upperBound(root, key)];
+		depth++;
+	}
+
+	int pos = _lowerBound(root, key);
+	if (root->nKeys < ORDER || (pos < root->nKeys && root->keys[pos] == key))
+		return 1;
+
+	int needed = run + (run == depth - 1);
+
+	spare->leaf = _makeLeaf();
+	if (spare->leaf == NULL)
+		return 0;
+
+	while (spare->nInners < needed)
+	{
+		INNER *inner = _makeInner();
+		if (inner == NULL)
+		{
+			free(spare->leaf);
+			while (spare->nInners > 0)
+				free(spare->inners[--(spare->nInners)]);
+			return 0;
+		}
+
+		spare->inners[(spare->nInners)++] = inner;
+	}
+
+	return 1;
+}
+
+/* Inserts new data into the tree
+	duplicates only increase the count of the existing key
+	return	1 success
+			0 overflow
+*/
+int BPT_Insert(BPTREE *pTree, int data)
+{
+	if (pTree->root == NULL)
+	{
+		LEAF *leaf = _makeLeaf();
+		if (leaf == NULL)
+			return 0;
+
+		pTree->root = (NODE *)leaf;
+	}
+
+	// all new nodes are allocated first, so an overflow leaves the tree unchanged
+	SPARE spare;
+	if (!_reserve(pTree->root, data, &spare))
+		return 0;
+
+	NODE *split;
+	int promoted;
+
+	_insert(pTree->root, data, &spare, &split, &promoted);
+
+	if (split != NULL)
+	{
+		INNER *newRoot = spare.inners[--spare.nInners];
+
+		newRoot->hdr.keys[0] = promoted;
+		newRoot->hdr.nKeys = 1;
+		newRoot->children[0] = pTree->root;
+		newRoot->children[1] = split;
+
+		pTree->root = (NODE *)newRoot;
+	}
+
+	(pTree->count)++;
+
+	return 1;
+}
+
+/* internal function
+	Removes keys[pos] and children[pos + 1] from an internal node
+*/
+static void _removeSeparator(INNER *inner, int pos)
+{
+	NODE *node = &inner->hdr;
+
+	memmove(node->keys + pos, node->keys + pos + 1, (node->nKeys - pos - 1) * sizeof(int));
+	memmove(inner->children + pos + 1, inner->children + pos + 2, (node->nKeys - pos - 1) * sizeof(NODE *));
+	node->nKeys--;
+}
+
+/* internal function
+	Refills leaf children[pos] of parent by borrowing from or merging with a sibling
+*/
+static void _fixLeaf(INNER *parent, int pos)
+{
+	LEAF *leaf = (LEAF *)parent->children[pos];
+	LEAF *left = (pos > 0) ? (LEAF *)parent->children[pos - 1] : NULL;
+	LEAF *right = (pos < parent->hdr.nKeys) ? (LEAF *)parent->children[pos + 1] : NULL;
+
+	if (left != NULL && left->hdr.nKeys > MIN_KEYS)
+	{
+		int n = leaf->hdr.nKeys;
+		memmove(leaf->hdr.keys + 1, leaf->hdr.keys, n * sizeof(int));
+		memmove(leaf->counts + 1, leaf->counts, n * sizeof(int));
+
+		left->hdr.nKeys--;
+		leaf->hdr.keys[0] = left->hdr.keys[left->hdr.nKeys];
+		leaf->counts[0] = left->counts[left->hdr.nKeys];
+		leaf->hdr.nKeys++;
+
+		parent->hdr.keys[pos - 1] = leaf->hdr.keys[0];
+	}
+
+	else if (right != NULL && right->hdr.nKeys > MIN_KEYS)
+	{
+		leaf->hdr.keys[leaf->hdr.nKeys] = right->hdr.keys[0];
+		leaf->counts[leaf->hdr.nKeys] = right->counts[0];
+		leaf->hdr.nKeys++;
+
+		right->hdr.nKeys--;
+		memmove(right->hdr.keys, right->hdr.keys + 1, right->hdr.nKeys * sizeof(int));
+		memmove(right->counts, right->counts + 1, right->hdr.nKeys * sizeof(int));
+
+		parent->hdr.keys[pos] = right->hdr.keys[0];
+	}
+
+	else
+	{
+		// merge with a sibling; always fold the right node into the left one
+		if (left == NULL)
+			left = leaf;
+
+		else
+		{
+			right = leaf;
+			pos--;
+		}
+
+		memcpy(left->hdr.keys + left->hdr.nKeys, right->hdr.keys, right->hdr.nKeys * sizeof(int));
+		memcpy(left->counts + left->hdr.nKeys, right->counts, right->hdr.nKeys * sizeof(int));
+		left->hdr.nKeys += right->hdr.nKeys;
+		left->next = right->next;
+
+		free(right);
+		_removeSeparator(parent, pos);
+	}
+}
+
+/* internal function
+	Refills internal node children[pos] of parent by borrowing from or merging with a sibling
+*/
+static void _fixInner(INNER *parent, int pos)
+{
+	INNER *node = (INNER *)parent->children[pos];
+	INNER *left = (pos > 0) ? (INNER *)parent->children[pos - 1] : NULL;
+	INNER *right = (pos < parent->hdr.nKeys) ? (INNER *)parent->children[pos + 1] : NULL;
+
+	if (left != NULL && left->hdr.nKeys > MIN_KEYS)
+	{
+		int n = node->hdr.nKeys;
+		memmove(node->hdr.keys + 1, node->hdr.keys, n * sizeof(int));
+		memmove(node->children + 1, node->children, (n + 1) * sizeof(NODE *));
+
+		node->hdr.keys[0] = parent->hdr.keys[pos - 1];
+		node->children[0] = left->children[left->hdr.nKeys];
+		node->hdr.nKeys++;
+
+		parent->hdr.keys[pos - 1] = left->hdr.keys[left->hdr.nKeys - 1];
+		left->hdr.nKeys--;
+	}
+
+	else if (right != NULL && right->hdr.nKeys > MIN_KEYS)
+	{
+		node->hdr.keys[node->hdr.nKeys] = parent->hdr.keys[pos];
+		node->children[node->hdr.nKeys + 1] = right->children[0];
+		node->hdr.nKeys++;
+
+		parent->hdr.keys[pos] = right->hdr.keys[0];
+
+		right->hdr.nKeys--;
+		memmove(right->hdr.keys, right->hdr.keys + 1, right->hdr.nKeys * sizeof(int));
+		memmove(right->children, right->children + 1, (right->hdr.nKeys + 1) * sizeof(NODE *));
+	}
+
+	else
+	{
+		if (left == NULL)
+			left = node;
+
+		else
+		{
+			right = node;
+			pos--;
+		}
+
+		// separator comes down between the two key lists
+		int n = left->hdr.nKeys;
+		left->hdr.keys[n] = parent->hdr.keys[pos];
+		memcpy(left->hdr.keys + n + 1, right->hdr.keys, right->hdr.nKeys * sizeof(int));
+		memcpy(left->children + n + 1, right->children, (right->hdr.nKeys + 1) * sizeof(NODE *));
+		left->hdr.nKeys += right->hdr.nKeys + 1;
+
+		free(right);
+		_removeSeparator(parent, pos);
+	}
+}
+
+/* internal function
+	This function uses recursion to remove one occurrence of dltKey
+	underflowing children are fixed on the way back up
+	return	1 if deleted; 0 if not found
+*/
+static int _delete(NODE *root, int dltKey)
+{
+	if (root->leaf)
+	{
+		LEAF *leaf = (LEAF *)root;
+		int pos = _lowerBound(root, dltKey);
+
+		if (pos == root->nKeys || root->keys[pos] != dltKey)
+			return 0;
+
+		if (--(leaf->counts[pos]) > 0)
+			return 1;
+
+		memmove(root->keys + pos, root->keys + pos + 1, (root->nKeys - pos - 1) * sizeof(int));
+		memmove(leaf->counts + pos, leaf->counts + pos + 1, (root->nKeys - pos - 1) * sizeof(int));
+		root->nKeys--;
+
+		return 1;
+	}
+
+	INNER *inner = (INNER *)root;
+	int pos = _upperBound(root, dltKey);
+	NODE *child = inner->children[pos];
+
+	if (!_delete(child, dltKey))
+		return 0;
+
+	if (child->nKeys < MIN_KEYS)
+	{
+		if (child->leaf)
+			_fixLeaf(inner, pos);
+
+		else
+			_fixInner(inner, pos);
+	}
+
+	return 1;
+}
+
+/* Deletes one occurrence of dltKey from the tree
+	return	1 success
+			0 not found
+*/
+int BPT_Delete(BPTREE *pTree, int dltKey)
+{
+	if (pTree->root == NULL)
+		return 0;
+
+	if (!_delete(pTree->root, dltKey))
+		return 0;
+
+	NODE *root = pTree->root;
+
+	if (root->nKeys == 0)
+	{
+		if (root->leaf)
+			pTree->root = NULL;
+
+		else
+			pTree->root = ((INNER *)root)->children[0];
+
+		free(root);
+	}
+
+	(pTree->count)--;
+
+	return 1;
+}
+
+/* internal function
+	return	leftmost leaf that may contain key
+*/
+static LEAF *_findLeaf(NODE *root, int key)
+{
+	if (root == NULL)
+		return NULL;
+
+	while (!root->leaf)
+		root = ((INNER *)root)->children[_upperBound(root, key)];
+
+	return (LEAF *)root;
+}
+
+/* Retrieve tree for the requested key
+	return	address of the key
+			NULL not found
+*/
+int *BPT_Retrieve(BPTREE *pTree, int key)
+{
+	LEAF *leaf = _findLeaf(pTree->root, key);
+	if (leaf == NULL)
+		return NULL;
+
+	int pos = _lowerBound(&leaf->hdr, key);
+
+	if (pos == leaf->hdr.nKeys || leaf->hdr.keys[pos] != key)
+		return NULL;
+
+	return &(leaf->hdr.keys[pos]);
+}
+
+/* Starts a scan of all keys in [first, last] (duplicates included)
+*/
+void BPT_RangeBegin(BPTREE *pTree, int first, int last, BPT_CURSOR *cursor)
+{
+	cursor->leaf = _findLeaf(pTree->root, first);
+	cursor->pos = (cursor->leaf != NULL) ? _lowerBound(&cursor->leaf->hdr, first) : 0;
+	cursor->dup = 0;
+	cursor->last = last;
+}
+
+/* Passes the next key of the range back to caller
+	return	1 if a key is returned; 0 if the range is exhausted
+*/
+int BPT_RangeNext(BPT_CURSOR *cursor, int *data)
+{
+	while (cursor->leaf != NULL && cursor->pos == cursor->leaf->hdr.nKeys)
+	{
+		cursor->leaf = cursor->leaf->next;
+		cursor->pos = 0;
+	}
+
+	if (cursor->leaf == NULL || cursor->leaf->hdr.keys[cursor->pos] > cursor->last)
+		return 0;
+
+	*data = cursor->leaf->hdr.keys[cursor->pos];
+
+	if (++(cursor->dup) == cursor->leaf->counts[cursor->pos])
+	{
+		cursor->pos++;
+		cursor->dup = 0;
+	}
+
+	return 1;
+}
+
+/* prints tree using inorder traversal (walks the leaf list)
+*/
+void BPT_Traverse(BPTREE *pTree)
+{
+	NODE *root = pTree->root;
+	if (root == NULL)
+		return;
+
+	while (!root->leaf)
+		root = ((INNER *)root)->children[0];
+
+	for (LEAF *leaf = (LEAF *)root; leaf != NULL; leaf = leaf->next)
+		for (int i = 0; i < leaf->hdr.nKeys; i++)
+			for (int j = 0; j < leaf->counts[i]; j++)
+				printf("%d ", leaf->hdr.keys[i]);
+}
+
+/* internal traversal function
+	a leaf is printed as one line of keys, separators in brackets
+*/
+static void _infix_print(NODE *root, int level)
+{
+	if (root == NULL)
+		return;
+
+	if (root->leaf)
+	{
+		for (int i = 0; i < level; i++)
+			printf("\t");
+		for (int i = 0; i < root->nKeys; i++)
+			printf("%d ", root->keys[i]);
+		printf("\n");
+		return;
+	}
+
+	INNER *inner = (INNER *)root;
+
+	for (int i = root->nKeys; i > 0; i--)
+	{
+		_infix_print(inner->children[i], level + 1);
+		for (int j = 0; j < level; j++)
+			printf("\t");
+		printf("[%d]\n", root->keys[i - 1]);
+	}
+	_infix_print(inner->children[0], level + 1);
+}
+
+/* Print tree using inorder right-to-left traversal
+*/
+void printTree(BPTREE *pTree)
+{
+	_infix_print(pTree->root, 0);
+}
+
+/*
+	return 1 if the tree is empty; 0 if not
+*/
+int BPT_Empty(BPTREE *pTree)
+{
+	if (pTree == NULL || pTree->root == NULL)
+		return 1;
+
+	else
+		return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	BPTREE *tree;
+	int data;
+
+	// creates a null tree
+	tree = BPT_Create();
+
+	if (!tree)
+	{
+		printf("Cannot create a tree!\n");
+		return 100;
+	}
+
+	fprintf(stdout, "How many numbers will you insert into a B+-tree: ");
+
+	int numbers;
+	scanf("%d", &numbers);
+
+	fprintf(stdout, "Inserting: ");
+
+	srand(time(NULL));
+	for (int i = 0; i < numbers; i++)
+	{
+		data = rand() % (numbers * 3) + 1; // random number (1 ~ numbers * 3)
+
+		fprintf(stdout, "%d ", data);
+
+		// insert funtion call
+		int ret = BPT_Insert(tree, data);
+		if (!ret)
+			break;
+	}
+	fprintf(stdout, "\n");
+
+	// inorder traversal
+	fprintf(stdout, "Inorder traversal: ");
+	BPT_Traverse(tree);
+	fprintf(stdout, "\n");
+
+	// print tree with right-to-left infix traversal
+	fprintf(stdout, "Tree representation:\n");
+	printTree(tree);
+
+	// range scan over the middle third of the key space
+	BPT_CURSOR cursor;
+	fprintf(stdout, "Keys in [%d, %d]: ", numbers, numbers * 2);
+	BPT_RangeBegin(tree, numbers, numbers * 2, &cursor);
+	while (BPT_RangeNext(&cursor, &data))
+		fprintf(stdout, "%d ", data);
+	fprintf(stdout, "\n");
+
+	while (1)
+	{
+		fprintf(stdout, "Input a number to delete: ");
+		int num;
+		int ret = scanf("%d", &num);
+		if (ret != 1)
+			break;
+
+		ret = BPT_Delete(tree, num);
+		if (!ret)
+		{
+			fprintf(stdout, "%d not found\n", num);
+			continue;
+		}
+
+		// print tree with right-to-left infix traversal
+		fprintf(stdout, "Tree representation:\n");
+		printTree(tree);
+
+		if (BPT_Empty(tree))
+		{
+			fprintf(stdout, "Empty tree!\n");
+			break;
+		}
+	}
+
+	BPT_Destroy(tree);
+
+	return 0;
+}
@@ -1,8 +1,14 @@
 #include <stdlib.h> // malloc, atoi, rand
 #include <stdio.h>
 #include <assert.h> // assert
+#include <string.h> // memcpy
 #include <time.h>	// time
 
+#define FREEZE 0 // freeze the tree into a read-only search array after loading in main
+#define ORDER_STAT 0 // show rank and range queries in main
+#define MULTISET 0 // duplicates increase the count of the existing node instead of adding a node
+#define BULK_LOAD 0 // build the tree in main from the whole array of numbers at once
+
 ////////////////////////////////////////////////////////////////////////////////
 // TREE type definition
 typedef struct node
@@ -10,13 +16,41 @@ typedef struct node
 	int data;
 	struct node *left;
 	struct node *right;
+	int count; // occurrences of data
+	int size;  // number of keys (counting duplicates) in the subtree rooted here
 } NODE;
 
 typedef struct
 {
 	NODE *root;
+	NODE *pool;	  // single allocation holding the nodes of a bulk-built tree (NULL if none)
+	int poolSize; // number of nodes in pool
 } TREE;
 
+// range scan position: stack of nodes whose keys are not returned yet
+typedef struct
+{
+	NODE **stack;
+	int top;
+	int capacity;
+	int dup;  // occurrences of the top node already returned
+	int last; // upper bound of the range (inclusive)
+} BST_ITER;
+
+////////////////////////////////////////////////////////////////////////////////
+// FROZEN_TREE type definition
+// read-only copy of a TREE laid out in Eytzinger (BFS) order:
+// children of keys[k] are keys[2k] and keys[2k + 1], keys[0] is unused
+typedef struct
+{
+	int *keys;
+	int *counts; // occurrences of keys[k]
+	int size;
+} FROZEN_TREE;
+
+#define CACHE_LINE 64
+#define KEYS_PER_LINE (CACHE_LINE / sizeof(int))
+
 ////////////////////////////////////////////////////////////////////////////////
 // Prototype declarations
 
@@ -31,33 +65,50 @@ TREE *BST_Create(void)
 		return NULL;
 
 	temp->root = NULL;
+	temp->pool = NULL;
+	temp->poolSize = 0;
 
 	return temp;
 }
 
+/* internal function
+	Frees a node unless it belongs to the pool of the tree
+*/
+static void _freeNode(TREE *pTree, NODE *node)
+{
+	if (node >= pTree->pool && node < pTree->pool + pTree->poolSize)
+		return;
+
+	free(node);
+}
+
 /* internal function (not mandatory)
 */
-static void _destroy(NODE *root) {
+static void _destroy(TREE *pTree, NODE *root) {
 	if (root == NULL)
 		return;
 
-	_destroy(root->left);
-	_destroy(root->right);
-	free(root);
+	_destroy(pTree, root->left);
+	_destroy(pTree, root->right);
+	_freeNode(pTree, root);
 }
 
 /* Deletes all data in tree and recycles memory
 */
 void BST_Destroy(TREE *pTree) {
-	_destroy(pTree->root);
+	_destroy(pTree, pTree->root);
 
+	free(pTree->pool);
 	free(pTree);
 }
 
+#if !MULTISET
 /* internal function (not mandatory)
 */
 static void _insert(NODE *root, NODE *newPtr)
 {
+	(root->size)++;
+
 	if (newPtr->data < root->data)
 	{
 		if (root->left == NULL)
@@ -82,6 +133,7 @@ static void _insert(NODE *root, NODE *newPtr)
 		return;
 	}
 }
+#endif
 
 NODE *_makeNode(int data)
 {
@@ -92,6 +144,8 @@ NODE *_makeNode(int data)
 
 	temp->data = data;
 	temp->left = temp->right = NULL;
+	temp->count = 1;
+	temp->size = 1;
 
 	return temp;
 }
@@ -102,6 +156,36 @@ NODE *_makeNode(int data)
 */
 int BST_Insert(TREE *pTree, int data)
 {
+#if MULTISET
+	// one descent bumps the counters on the search path;
+	// an existing key only increases its count
+	NODE **link = &pTree->root;
+	while (*link != NULL)
+	{
+		((*link)->size)++;
+
+		if (data == (*link)->data)
+		{
+			((*link)->count)++;
+			return 1;
+		}
+
+		link = (data < (*link)->data) ? &(*link)->left : &(*link)->right;
+	}
+
+	NODE *newNode = _makeNode(data);
+
+	if (newNode == NULL)
+	{
+		// takes back the counters bumped on the way down
+		for (NODE *root = pTree->root; root != NULL; root = (data < root->data) ? root->left : root->right)
+			(root->size)--;
+
+		return 0;
+	}
+
+	*link = newNode;
+#else
 	NODE *newNode = _makeNode(data);
 
 	if (newNode == NULL)
@@ -112,15 +196,28 @@ int BST_Insert(TREE *pTree, int data)
 
 	else
 		pTree->root = newNode;
+#endif
 
 	return 1;
 }
 
+/* internal function
+	return	number of keys in the (sub)tree, duplicates included
+			(_count counts nodes)
+*/
+static int _size(NODE *root)
+{
+	if (root == NULL)
+		return 0;
+
+	return root->size;
+}
+
 /* internal function
 	success is 1 if deleted; 0 if not
 	return	pointer to root
 */
-static NODE *_delete(NODE *root, int dltKey, int *success)
+static NODE *_delete(TREE *pTree, NODE *root, int dltKey, int *success)
 {
 	if (root == NULL)
 	{
@@ -129,10 +226,16 @@ static NODE *_delete(NODE *root, int dltKey, int *success)
 	}
 
 	if (dltKey < root->data)
-		root->left = _delete(root->left, dltKey, success);
+		root->left = _delete(pTree, root->left, dltKey, success);
 
 	else if (dltKey > root->data)
-		root->right = _delete(root->right, dltKey, success);
+		root->right = _delete(pTree, root->right, dltKey, success);
+
+	else if (root->count > 1)
+	{
+		(root->count)--;
+		*success = 1;
+	}
 
 	else
 	{
@@ -140,14 +243,14 @@ static NODE *_delete(NODE *root, int dltKey, int *success)
 		{
 			NODE *delNode = root;
 			root = root->right;
-			free(delNode);
+			_freeNode(pTree, delNode);
 		}
 
 		else if (root->right == NULL)
 		{
 			NODE *delNode = root;
 			root = root->left;
-			free(delNode);
+			_freeNode(pTree, delNode);
 		}
 
 		else
@@ -158,13 +261,19 @@ static NODE *_delete(NODE *root, int dltKey, int *success)
 				temp = temp->left;
 			}
 
+			// move all occurrences of the successor up and remove its node
 			root->data = temp->data;
-			root->right = _delete(root->right, temp->data, success);
+			root->count = temp->count;
+			temp->count = 1;
+			root->right = _delete(pTree, root->right, temp->data, success);
 		}
 
 		*success = 1;
 	}
 
+	if (root != NULL)
+		root->size = _size(root->left) + _size(root->right) + root->count;
+
 	return root;
 }
 
@@ -176,7 +285,7 @@ int BST_Delete(TREE *pTree, int dltKey)
 {
 	int success = 0;
 
-	pTree->root = _delete(pTree->root, dltKey, &success);
+	pTree->root = _delete(pTree, pTree->root, dltKey, &success);
 
 	return success;
 }
@@ -224,7 +333,8 @@ static void _traverse(NODE *root)
 		return;
 
 	_traverse(root->left);
-	printf("%d ", root->data);
+	for (int i = 0; i < root->count; i++)
+		printf("%d ", root->data);
 	_traverse(root->right);
 }
 
@@ -235,6 +345,410 @@ void BST_Traverse(TREE *pTree)
 	_traverse(pTree->root);
 }
 
+/* internal function
+	return	number of keys less than key (less than or equal to key if inclusive)
+*/
+static int _rank(NODE *root, int key, int inclusive)
+{
+	int rank = 0;
+
+	while (root != NULL)
+	{
+		if (root->data < key || (inclusive && root->data == key))
+		{
+			rank += _size(root->left) + root->count;
+			root = root->right;
+		}
+
+		else
+			root = root->left;
+	}
+
+	return rank;
+}
+
+/* Counts keys in [first, last]
+	return	number of keys in the range
+*/
+int BST_Count(TREE *pTree, int first, int last)
+{
+	if (first > last)
+		return 0;
+
+	return _rank(pTree->root, last, 1) - _rank(pTree->root, first, 0);
+}
+
+/* Retrieve tree for the k-th smallest key (k starts from 1)
+	return	address of data of the node containing the key
+			NULL if k is out of range
+*/
+int *BST_Select(TREE *pTree, int k)
+{
+	NODE *root = pTree->root;
+
+	while (root != NULL)
+	{
+		int leftSize = _size(root->left);
+
+		if (k <= leftSize)
+			root = root->left;
+
+		else if (k <= leftSize + root->count)
+			return &(root->data);
+
+		else
+		{
+			k -= leftSize + root->count;
+			root = root->right;
+		}
+	}
+
+	return NULL;
+}
+
+/* internal function
+	return	1 success
+			0 overflow
+*/
+static int _push(BST_ITER *iter, NODE *node)
+{
+	if (iter->top == iter->capacity)
+	{
+		int capacity = (iter->capacity == 0) ? 32 : iter->capacity * 2;
+		NODE **stack = (NODE **)realloc(iter->stack, capacity * sizeof(NODE *));
+
+		if (stack == NULL)
+			return 0;
+
+		iter->stack = stack;
+		iter->capacity = capacity;
+	}
+
+	iter->stack[(iter->top)++] = node;
+
+	return 1;
+}
+
+/* Starts a scan of keys in [first, last] in ascending order
+	return	1 success
+			0 overflow
+*/
+int BST_RangeBegin(TREE *pTree, int first, int last, BST_ITER *iter)
+{
+	iter->stack = NULL;
+	iter->top = iter->capacity = 0;
+	iter->dup = 0;
+	iter->last = last;
+
+	// keep only the nodes on the search path for first that are not below it
+	for (NODE *root = pTree->root; root != NULL;)
+	{
+		if (root->data >= first)
+		{
+			if (!_push(iter, root))
+				return 0;
+
+			root = root->left;
+		}
+
+		else
+			root = root->right;
+	}
+
+	return 1;
+}
+
+/* Passes the next key of the range back to caller
+	return	1 if a key is returned; 0 if the range is exhausted (or overflow)
+*/
+int BST_RangeNext(BST_ITER *iter, int *data)
+{
+	if (iter->top == 0)
+		return 0;
+
+	NODE *node = iter->stack[iter->top - 1];
+
+	if (node->data > iter->last)
+	{
+		iter->top = 0;
+		return 0;
+	}
+
+	*data = node->data;
+
+	if (++(iter->dup) < node->count)
+		return 1;
+
+	(iter->top)--;
+	iter->dup = 0;
+
+	for (NODE *root = node->right; root != NULL; root = root->left)
+		if (!_push(iter, root))
+			return 0;
+
+	return 1;
+}
+
+/* Recycles memory of the range scan
+*/
+void BST_RangeEnd(BST_ITER *iter)
+{
+	free(iter->stack);
+	iter->stack = NULL;
+	iter->top = iter->capacity = 0;
+}
+
+/* internal function
+	return	number of nodes in the (sub)tree
+			(_size counts keys, duplicates included)
+*/
+static int _count(NODE *root)
+{
+	if (root == NULL)
+		return 0;
+
+	return _count(root->left) + _count(root->right) + 1;
+}
+
+/* internal function
+	Copies nodes of the (sub)tree into sorted[] in inorder
+*/
+static void _flatten(NODE *root, NODE *sorted[], int *n)
+{
+	if (root == NULL)
+		return;
+
+	_flatten(root->left, sorted, n);
+	sorted[(*n)++] = root;
+	_flatten(root->right, sorted, n);
+}
+
+/* internal function
+	Fills keys[k] and its descendants from sorted[] in inorder of the implicit tree
+*/
+static void _eytzinger(NODE *sorted[], int *i, FROZEN_TREE *pFrozen, int k)
+{
+	if (k > pFrozen->size)
+		return;
+
+	_eytzinger(sorted, i, pFrozen, 2 * k);
+	pFrozen->keys[k] = sorted[*i]->data;
+	pFrozen->counts[k] = sorted[*i]->count;
+	(*i)++;
+	_eytzinger(sorted, i, pFrozen, 2 * k + 1);
+}
+
+/* Converts the tree into a read-only search array
+	the tree itself is not changed
+	return	frozen tree pointer
+			NULL if overflow
+*/
+FROZEN_TREE *BST_Freeze(TREE *pTree)
+{
+	FROZEN_TREE *temp = (FROZEN_TREE *)malloc(sizeof(FROZEN_TREE));
+	if (temp == NULL)
+		return NULL;
+
+	temp->size = _count(pTree->root);
+
+	// keys[1] .. keys[size] and every prefetch target keys[16k] stay line-aligned
+	size_t bytes = (temp->size + 1) * sizeof(int);
+	bytes = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+	temp->keys = (int *)aligned_alloc(CACHE_LINE, bytes);
+	temp->counts = (int *)malloc((temp->size + 1) * sizeof(int));
+	NODE **sorted = (NODE **)malloc((temp->size + 1) * sizeof(NODE *));
+
+	if (temp->keys == NULL || temp->counts == NULL || sorted == NULL)
+	{
+		free(temp->keys);
+		free(temp->counts);
+		free(sorted);
+		free(temp);
+		return NULL;
+	}
+
+	int n = 0;
+	_flatten(pTree->root, sorted, &n);
+
+	n = 0;
+	_eytzinger(sorted, &n, temp, 1);
+
+	free(sorted);
+
+	return temp;
+}
+
+/* Retrieve frozen tree for the requested key
+	descends without branching on the comparison and prefetches
+	the cache line holding the descendants four levels below
+	return	address of the key
+			NULL not found
+*/
+int *BST_FrozenRetrieve(FROZEN_TREE *pFrozen, int key)
+{
+	int *keys = pFrozen->keys;
+	int k = 1;
+
+	while (k <= pFrozen->size)
+	{
+		__builtin_prefetch(keys + KEYS_PER_LINE * k);
+		k = 2 * k + (keys[k] < key);
+	}
+
+	// drop the trailing right turns and the last left turn
+	k >>= __builtin_ffs(~k);
+
+	if (k == 0 || keys[k] != key)
+		return NULL;
+
+	return &keys[k];
+}
+
+/* internal function
+	Rebuilds the subtree rooted at keys[k] in pool[k - 1]
+	return	pointer to root
+*/
+static NODE *_thaw(FROZEN_TREE *pFrozen, NODE pool[], int k)
+{
+	if (k > pFrozen->size)
+		return NULL;
+
+	NODE *temp = &pool[k - 1];
+
+	temp->data = pFrozen->keys[k];
+	temp->count = pFrozen->counts[k];
+	temp->left = _thaw(pFrozen, pool, 2 * k);
+	temp->right = _thaw(pFrozen, pool, 2 * k + 1);
+	temp->size = _size(temp->left) + _size(temp->right) + temp->count;
+
+	return temp;
+}
+
+/* Converts a frozen tree back into a tree for updates
+	the resulting tree has the shape of the frozen array (balanced)
+	and its nodes share one allocation
+	return	tree pointer
+			NULL if overflow
+*/
+TREE *BST_Thaw(FROZEN_TREE *pFrozen)
+{
+	TREE *temp = BST_Create();
+	if (temp == NULL)
+		return NULL;
+
+	if (pFrozen->size > 0)
+	{
+		temp->pool = (NODE *)malloc(pFrozen->size * sizeof(NODE));
+		if (temp->pool == NULL)
+		{
+			free(temp);
+			return NULL;
+		}
+
+		temp->poolSize = pFrozen->size;
+		temp->root = _thaw(pFrozen, temp->pool, 1);
+	}
+
+	return temp;
+}
+
+/* Deletes frozen tree and recycles memory
+*/
+void BST_FrozenDestroy(FROZEN_TREE *pFrozen)
+{
+	if (pFrozen == NULL)
+		return;
+
+	free(pFrozen->keys);
+	free(pFrozen->counts);
+	free(pFrozen);
+}
+
+/* internal function
+	Links pool[first .. last] into a balanced subtree
+	return	pointer to root
+*/
+static NODE *_build(NODE pool[], int first, int last)
+{
+	if (first > last)
+		return NULL;
+
+	int mid = first + (last - first) / 2;
+	NODE *root = &pool[mid];
+
+	root->left = _build(pool, first, mid - 1);
+	root->right = _build(pool, mid + 1, last);
+	root->size = _size(root->left) + _size(root->right) + root->count;
+
+	return root;
+}
+
+static int _compare(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Builds a balanced tree holding the n keys of array
+	sorted input is detected and built in O(n); other input is sorted first
+	all nodes share one allocation
+	return	tree pointer
+			NULL if overflow
+*/
+TREE *BST_BuildFrom(int array[], int n)
+{
+	TREE *temp = BST_Create();
+	if (temp == NULL)
+		return NULL;
+
+	if (n <= 0)
+		return temp;
+
+	int *sorted = (int *)malloc(n * sizeof(int));
+	temp->pool = (NODE *)malloc(n * sizeof(NODE));
+
+	if (sorted == NULL || temp->pool == NULL)
+	{
+		free(sorted);
+		free(temp->pool);
+		free(temp);
+		return NULL;
+	}
+
+	memcpy(sorted, array, n * sizeof(int));
+
+	for (int i = 1; i < n; i++)
+		if (sorted[i - 1] > sorted[i])
+		{
+			qsort(sorted, n, sizeof(int), _compare);
+			break;
+		}
+
+	int nodes = 0;
+	for (int i = 0; i < n; i++)
+	{
+#if MULTISET
+		if (nodes > 0 && temp->pool[nodes - 1].data == sorted[i])
+		{
+			(temp->pool[nodes - 1].count)++;
+			continue;
+		}
+#endif
+		temp->pool[nodes].data = sorted[i];
+		temp->pool[nodes].count = 1;
+		nodes++;
+	}
+
+	free(sorted);
+
+	temp->poolSize = nodes;
+	temp->root = _build(temp->pool, 0, nodes - 1);
+
+	return temp;
+}
+
 /* internal traversal function
 */
 static void _infix_print(NODE *root, int level)
@@ -245,7 +759,10 @@ static void _infix_print(NODE *root, int level)
 	_infix_print(root->right, level + 1);
 	for (int i = 0; i < level; i++)
 		printf("\t");
-	printf("%d\n", root->data);
+	if (root->count > 1)
+		printf("%d (x%d)\n", root->data, root->count);
+	else
+		printf("%d\n", root->data);
 	_infix_print(root->left, level + 1);
 }
 
@@ -290,6 +807,20 @@ int main(int argc, char **argv)
 
 	fprintf(stdout, "Inserting: ");
 
+#if BULK_LOAD
+	int *array = NULL;
+	if (numbers > 0)
+	{
+		array = (int *)malloc(numbers * sizeof(int));
+		if (array == NULL)
+		{
+			printf("Cannot allocate numbers!\n");
+			BST_Destroy(tree);
+			return 100;
+		}
+	}
+#endif
+
 	srand(time(NULL));
 	for (int i = 0; i < numbers; i++)
 	{
@@ -297,13 +828,29 @@ int main(int argc, char **argv)
 
 		fprintf(stdout, "%d ", data);
 
+#if BULK_LOAD
+		array[i] = data;
+#else
 		// insert funtion call
 		int ret = BST_Insert(tree, data);
 		if (!ret)
 			break;
+#endif
 	}
 	fprintf(stdout, "\n");
 
+#if BULK_LOAD
+	BST_Destroy(tree);
+	tree = BST_BuildFrom(array, numbers);
+	free(array);
+
+	if (!tree)
+	{
+		printf("Cannot build a tree!\n");
+		return 100;
+	}
+#endif
+
 	// inorder traversal
 	fprintf(stdout, "Inorder traversal: ");
 	BST_Traverse(tree);
@@ -313,6 +860,49 @@ int main(int argc, char **argv)
 	fprintf(stdout, "Tree representation:\n");
 	printTree(tree);
 
+#if ORDER_STAT
+	int *median = BST_Select(tree, (numbers + 1) / 2);
+	if (median != NULL)
+		fprintf(stdout, "Median: %d\n", *median);
+	fprintf(stdout, "Keys in [%d, %d]: %d (", numbers, numbers * 2, BST_Count(tree, numbers, numbers * 2));
+
+	BST_ITER iter;
+	BST_RangeBegin(tree, numbers, numbers * 2, &iter);
+	while (BST_RangeNext(&iter, &data))
+		fprintf(stdout, " %d", data);
+	BST_RangeEnd(&iter);
+	fprintf(stdout, " )\n");
+#endif
+
+#if FREEZE
+	FROZEN_TREE *frozen = BST_Freeze(tree);
+	if (frozen == NULL)
+	{
+		printf("Cannot freeze the tree!\n");
+		return 100;
+	}
+
+	BST_Destroy(tree);
+
+	int found = 0;
+	clock_t start = clock();
+	for (int i = 1; i <= numbers * 3; i++)
+		if (BST_FrozenRetrieve(frozen, i))
+			found++;
+
+	fprintf(stdout, "Frozen lookups: %d of %d found (%.3f sec)\n", found, numbers * 3,
+			(double)(clock() - start) / CLOCKS_PER_SEC);
+
+	tree = BST_Thaw(frozen);
+	BST_FrozenDestroy(frozen);
+
+	if (!tree)
+	{
+		printf("Cannot thaw the tree!\n");
+		return 100;
+	}
+#endif
+
 	while (1)
 	{
 		fprintf(stdout, "Input a number to delete: ");
@@ -1,27 +1,116 @@
 #include <stdio.h>
-#include <stdlib.h> // malloc, rand
+#include <stdlib.h> // malloc, aligned_alloc, rand
+#include <string.h> // memcpy
+#include <limits.h> // UINT_MAX
 #include <time.h>	// time
 
 #define MAX_ELEM 20
+#define BENCHMARK 0 // measure push/pop throughput instead of running the demo
+#define BULK_LOAD 0 // build the demo heap from all random numbers at once
+#define CONCURRENT 0 // multi-threaded MultiQueue scaling benchmark instead of the demo (link with -pthread)
+#define RADIX_HEAP 0 // use a radix heap for the demo (keys are bounded and deleted in order)
 
+#define HEAP_DEGREE 2 // children per node; 4 puts all children of a node in one cache line
+#define CACHE_LINE 64
+#define RADIX_BUCKETS 33 // bucket 0 and one per bit of an unsigned int
+
+#if CONCURRENT
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h> // uintptr_t
+#endif
+
+typedef struct
+{
+	int key;
+	int handle;	   // stable name of the element in an indexed heap
+	void *payload; // caller's data carried with the key
+} ELEMENT;
+
+// children of heapArr[i] are heapArr[i * HEAP_DEGREE + 1 .. i * HEAP_DEGREE + HEAP_DEGREE]
+// heapArr starts HEAP_DEGREE - 1 elements into an aligned block so every group of children
+// starts on an aligned boundary
 typedef struct
 {
-	int *heapArr;
+	ELEMENT *heapArr;
+	ELEMENT *block; // allocation holding heapArr
 	int last;
 	int capacity;
+	int (*compare)(int, int); // positive if the first key has higher priority
+
+	// indexed heap only (NULL otherwise): handle -> index in heapArr (-1 if unused)
+	int *position;
+	int *freeHandles; // released handles for reuse
+	int nFree;
+	int nHandles; // handles ever given out
+
+	struct radix *radix; // radix heap only (NULL otherwise); heapArr is not used then
 } HEAP;
 
+typedef struct
+{
+	ELEMENT *elems;
+	int size;
+	int capacity;
+} BUCKET;
+
+// radix heap for bounded integer keys deleted in monotone order
+// keys are mapped to unsigned values ordered by priority (smallest first);
+// bucket 0 holds values equal to lastKey, bucket i (> 0) the values whose highest bit
+// differing from lastKey is bit i - 1
+typedef struct radix
+{
+	BUCKET buckets[RADIX_BUCKETS];
+	unsigned int lastKey; // value of the last deleted key
+	unsigned int maxKey;  // keys must be in 0 ~ maxKey
+	int reversed;		  // 1 for max heap: a key is stored as maxKey - key
+} RADIX;
+
+/* Priority orders for heapCreate
+max heap: larger key first
+*/
+int maxCompare(int a, int b)
+{
+	return (a > b) - (a < b);
+}
+
+/* min heap: smaller key first
+*/
+int minCompare(int a, int b)
+{
+	return (a < b) - (a > b);
+}
+
+/* Allocates an aligned block for capacity elements
+return address of element 0; NULL if memory overflow
+*/
+static ELEMENT *_allocArray(int capacity, ELEMENT **block)
+{
+	size_t bytes = (capacity + HEAP_DEGREE - 1) * sizeof(ELEMENT);
+	bytes = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+	*block = aligned_alloc(CACHE_LINE, bytes);
+	if (*block == NULL)
+		return NULL;
+
+	return *block + HEAP_DEGREE - 1;
+}
+
 /* Allocates memory for heap and returns address of heap head structure
+capacity is only the initial size; the array grows as needed
 if memory overflow, NULL returned
 */
-HEAP *heapCreate(int capacity)
+HEAP *heapCreate(int capacity, int (*compare)(int, int))
 {
 	HEAP *temp = malloc(sizeof(HEAP));
 
 	if (temp == NULL)
 		return NULL;
 
-	temp->heapArr = malloc(capacity * sizeof(int));
+	if (capacity < 1)
+		capacity = 1;
+
+	temp->heapArr = _allocArray(capacity, &temp->block);
 
 	if (temp->heapArr == NULL)
 	{
@@ -31,6 +120,37 @@ HEAP *heapCreate(int capacity)
 
 	temp->last = -1;
 	temp->capacity = capacity;
+	temp->compare = compare;
+	temp->position = NULL;
+	temp->freeHandles = NULL;
+	temp->nFree = temp->nHandles = 0;
+	temp->radix = NULL;
+
+	return temp;
+}
+
+/* Allocates memory for an indexed heap, which additionally supports
+heapInsertHandle, heapUpdate and heapRemove
+if memory overflow, NULL returned
+*/
+HEAP *heapCreateIndexed(int capacity, int (*compare)(int, int))
+{
+	HEAP *temp = heapCreate(capacity, compare);
+
+	if (temp == NULL)
+		return NULL;
+
+	temp->position = malloc(temp->capacity * sizeof(int));
+	temp->freeHandles = malloc(temp->capacity * sizeof(int));
+
+	if (temp->position == NULL || temp->freeHandles == NULL)
+	{
+		free(temp->position);
+		free(temp->freeHandles);
+		free(temp->block);
+		free(temp);
+		return NULL;
+	}
 
 	return temp;
 }
@@ -42,118 +162,1041 @@ void heapDestroy(HEAP *heap)
 	if (heap == NULL)
 		return;
 
-	free(heap->heapArr);
+	if (heap->radix != NULL)
+		for (int i = 0; i < RADIX_BUCKETS; i++)
+			free(heap->radix->buckets[i].elems);
+
+	free(heap->block);
+	free(heap->position);
+	free(heap->freeHandles);
+	free(heap->radix);
 	free(heap);
 }
 
+/* Allocates memory for a radix heap with keys in 0 ~ maxKey
+only maxCompare and minCompare orders are supported, and every inserted key
+must not have higher priority than the last deleted one (monotone deletes);
+heapInsert and heapDelete then run in O(1) amortized time
+if memory overflow or unsupported order, NULL returned
+*/
+HEAP *heapCreateRadix(int maxKey, int (*compare)(int, int))
+{
+	if (maxKey < 0 || (compare != maxCompare && compare != minCompare))
+		return NULL;
+
+	HEAP *temp = heapCreate(1, compare);
+
+	if (temp == NULL)
+		return NULL;
+
+	temp->radix = calloc(1, sizeof(RADIX));
+	if (temp->radix == NULL)
+	{
+		heapDestroy(temp);
+		return NULL;
+	}
+
+	temp->radix->maxKey = maxKey;
+	temp->radix->reversed = (compare == maxCompare);
+	temp->radix->lastKey = 0;
+
+	return temp;
+}
+
+/* Writes elem at index and keeps the handle map of an indexed heap up to date
+*/
+static inline void _place(HEAP *heap, int index, ELEMENT elem)
+{
+	heap->heapArr[index] = elem;
+
+	if (heap->position != NULL)
+		heap->position[elem.handle] = index;
+}
+
 /* Reestablishes heap by moving data in child up to correct location heap array
+parents are shifted down into the hole and the data is written once
 */
 static void _reheapUp(HEAP *heap, int index)
 {
-	if (index == 0)
-		return;
+	ELEMENT elem = heap->heapArr[index];
 
-	if (heap->heapArr[index] > heap->heapArr[(index - 1) / 2])
+	while (index > 0)
 	{
-		int temp = heap->heapArr[index];
-		heap->heapArr[index] = heap->heapArr[(index - 1) / 2];
-		heap->heapArr[(index - 1) / 2] = temp;
+		int parent = (index - 1) / HEAP_DEGREE;
+
+		if (heap->compare(elem.key, heap->heapArr[parent].key) <= 0)
+			break;
+
+		_place(heap, index, heap->heapArr[parent]);
+		index = parent;
+	}
+
+	_place(heap, index, elem);
+}
+
+/* Doubles the capacity of heap array
+return 1 if successful; 0 if memory overflow
+*/
+static int _grow(HEAP *heap)
+{
+	ELEMENT *block;
+	ELEMENT *temp = _allocArray(2 * heap->capacity, &block);
+
+	if (temp == NULL)
+		return 0;
+
+	memcpy(temp, heap->heapArr, (heap->last + 1) * sizeof(ELEMENT));
+	free(heap->block);
+
+	heap->heapArr = temp;
+	heap->block = block;
+
+	if (heap->position != NULL)
+	{
+		int *position = realloc(heap->position, 2 * heap->capacity * sizeof(int));
+		if (position == NULL)
+			return 0;
+		heap->position = position;
+
+		int *freeHandles = realloc(heap->freeHandles, 2 * heap->capacity * sizeof(int));
+		if (freeHandles == NULL)
+			return 0;
+		heap->freeHandles = freeHandles;
+	}
+
+	heap->capacity *= 2;
+
+	return 1;
+}
+
+/* return value of key in radix order (smaller value has higher priority)
+*/
+static unsigned int _radixValue(RADIX *radix, int key)
+{
+	return radix->reversed ? radix->maxKey - (unsigned int)key : (unsigned int)key;
+}
+
+/* return bucket for value relative to the last deleted value
+*/
+static int _bucketIndex(RADIX *radix, unsigned int value)
+{
+	if (value == radix->lastKey)
+		return 0;
+
+	return 32 - __builtin_clz(value ^ radix->lastKey);
+}
+
+/* Makes room for more elements in bucket
+return 1 if successful; 0 if memory overflow
+*/
+static int _reserve(BUCKET *bucket, int more)
+{
+	if (bucket->size + more <= bucket->capacity)
+		return 1;
+
+	int capacity = (bucket->capacity == 0) ? 4 : bucket->capacity;
+	while (capacity < bucket->size + more)
+		capacity *= 2;
+
+	ELEMENT *temp = realloc(bucket->elems, capacity * sizeof(ELEMENT));
+	if (temp == NULL)
+		return 0;
+
+	bucket->elems = temp;
+	bucket->capacity = capacity;
+
+	return 1;
+}
+
+/* Inserts key with its payload into radix heap
+return 1 if successful; 0 if memory overflow, key out of range or key before the last deleted one
+*/
+static int _radixInsert(HEAP *heap, int key, void *payload)
+{
+	RADIX *radix = heap->radix;
+
+	if (key < 0 || (unsigned int)key > radix->maxKey)
+		return 0;
+
+	unsigned int value = _radixValue(radix, key);
+	if (value < radix->lastKey)
+		return 0;
+
+	BUCKET *bucket = &radix->buckets[_bucketIndex(radix, value)];
+	if (!_reserve(bucket, 1))
+		return 0;
 
-		_reheapUp(heap, (index - 1) / 2);
+	ELEMENT *elem = &bucket->elems[(bucket->size)++];
+	elem->key = key;
+	elem->payload = payload;
+
+	(heap->last)++;
+
+	return 1;
+}
+
+/* Removes element with highest priority from non-empty radix heap
+if bucket 0 is empty, the first non-empty bucket is emptied into lower buckets
+around its minimum (each element moves down at most 32 times in total)
+return 1 if successful; 0 if memory overflow
+*/
+static int _radixRemove(HEAP *heap, ELEMENT *elem)
+{
+	RADIX *radix = heap->radix;
+
+	if (radix->buckets[0].size == 0)
+	{
+		int i = 1;
+		while (radix->buckets[i].size == 0)
+			i++;
+
+		BUCKET *bucket = &radix->buckets[i];
+		unsigned int min = UINT_MAX;
+
+		for (int j = 0; j < bucket->size; j++)
+		{
+			unsigned int value = _radixValue(radix, bucket->elems[j].key);
+			if (value < min)
+				min = value;
+		}
+
+		unsigned int oldLastKey = radix->lastKey;
+		radix->lastKey = min;
+
+		// reserve room first so that no element is lost half way
+		int counts[RADIX_BUCKETS] = {0};
+		for (int j = 0; j < bucket->size; j++)
+			counts[_bucketIndex(radix, _radixValue(radix, bucket->elems[j].key))]++;
+
+		for (int b = 0; b < i; b++)
+			if (!_reserve(&radix->buckets[b], counts[b]))
+			{
+				radix->lastKey = oldLastKey;
+				return 0;
+			}
+
+		for (int j = 0; j < bucket->size; j++)
+		{
+			BUCKET *target = &radix->buckets[_bucketIndex(radix, _radixValue(radix, bucket->elems[j].key))];
+			target->elems[(target->size)++] = bucket->elems[j];
+		}
+
+		bucket->size = 0;
 	}
+
+	*elem = radix->buckets[0].elems[--(radix->buckets[0].size)];
+	(heap->last)--;
+
+	return 1;
 }
 
-/* Inserts data into heap
-return 1 if successful; 0 if heap full
+/* Inserts key with its payload into heap
+handle receives the name of the element in an indexed heap (may be NULL)
+return 1 if successful; 0 if memory overflow
 */
-int heapInsert(HEAP *heap, int data)
+int heapInsertHandle(HEAP *heap, int key, void *payload, int *handle)
 {
 	if (heap == NULL)
 		return 0;
 
-	heap->heapArr[++(heap->last)] = data;
+	if (heap->radix != NULL)
+		return _radixInsert(heap, key, payload);
+
+	if (heap->last == heap->capacity - 1 && !_grow(heap))
+		return 0;
+
+	ELEMENT *elem = &heap->heapArr[++(heap->last)];
+	elem->key = key;
+	elem->payload = payload;
+
+	if (heap->position != NULL)
+	{
+		// live + free handles never exceed capacity
+		elem->handle = (heap->nFree > 0) ? heap->freeHandles[--(heap->nFree)] : (heap->nHandles)++;
+		heap->position[elem->handle] = heap->last;
+
+		if (handle != NULL)
+			*handle = elem->handle;
+	}
 
 	_reheapUp(heap, heap->last);
 
 	return 1;
 }
 
-/* Reestablishes heap by moving data in root down to its correct location in the heap
+/* Inserts key with its payload into heap
+return 1 if successful; 0 if memory overflow
+*/
+int heapInsert(HEAP *heap, int key, void *payload)
+{
+	return heapInsertHandle(heap, key, payload, NULL);
+}
+
+/* Gives the handle of a removed element back for reuse
+*/
+static void _releaseHandle(HEAP *heap, int handle)
+{
+	if (heap->position == NULL)
+		return;
+
+	heap->position[handle] = -1;
+	heap->freeHandles[(heap->nFree)++] = handle;
+}
+
+/* return index in heap array of the element named by handle; -1 if invalid
+*/
+static int _lookupHandle(HEAP *heap, int handle)
+{
+	if (heap == NULL || heap->position == NULL || handle < 0 || handle >= heap->nHandles)
+		return -1;
+
+	return heap->position[handle];
+}
+
+/* Finds the child with the highest priority among the children starting at first
+(they share one aligned group, so this touches a single cache line for HEAP_DEGREE 4)
+return index of the child
+*/
+static int _bestChild(HEAP *heap, int first)
+{
+#if HEAP_DEGREE == 2
+	// kept as a branch: a conditional move would serialize the loads of the next level
+	if (first + 1 <= heap->last &&
+		heap->compare(heap->heapArr[first].key, heap->heapArr[first + 1].key) <= 0)
+		return first + 1;
+
+	return first;
+#else
+	int last = first + HEAP_DEGREE - 1;
+	int best = first;
+
+	if (last > heap->last)
+		last = heap->last;
+
+	for (int child = first + 1; child <= last; child++)
+		if (heap->compare(heap->heapArr[best].key, heap->heapArr[child].key) <= 0)
+			best = child;
+
+	return best;
+#endif
+}
+
+/* Moves the hole at index down to a leaf, always filling it from the higher priority child
+(no comparison against the data that will fill the hole)
+return index of the hole
+*/
+static int _holeDown(HEAP *heap, int index)
+{
+	int child;
+
+	while ((child = index * HEAP_DEGREE + 1) <= heap->last)
+	{
+		// grandchildren are contiguous; fetch them while the children are compared
+		ELEMENT *grand = &heap->heapArr[child * HEAP_DEGREE + 1];
+		for (int i = 0; i < HEAP_DEGREE * HEAP_DEGREE; i += CACHE_LINE / sizeof(ELEMENT))
+			__builtin_prefetch(grand + i);
+
+		child = _bestChild(heap, child);
+
+		_place(heap, index, heap->heapArr[child]);
+		index = child;
+	}
+
+	return index;
+}
+
+/* Reestablishes heap by moving data at index down to its correct location in the heap
+children are shifted up into the hole and the data is written once
 */
 static void _reheapDown(HEAP *heap, int index)
 {
-	int left = -1, right = -1, subtree;
+	ELEMENT elem = heap->heapArr[index];
+	int child;
 
-	if (index * 2 + 1 <= heap->last)
+	while ((child = index * HEAP_DEGREE + 1) <= heap->last)
+	{
+		child = _bestChild(heap, child);
+
+		if (heap->compare(heap->heapArr[child].key, elem.key) <= 0)
+			break;
+
+		_place(heap, index, heap->heapArr[child]);
+		index = child;
+	}
+
+	_place(heap, index, elem);
+}
+
+/* Removes root of non-empty heap
+the last data drops into the leaf hole left by the root and moves up (Floyd)
+return the removed root
+*/
+static ELEMENT _removeRoot(HEAP *heap)
+{
+	ELEMENT root = heap->heapArr[0];
+	ELEMENT last = heap->heapArr[(heap->last)--];
+
+	if (heap->last >= 0)
+	{
+		int hole = _holeDown(heap, 0);
+
+		_place(heap, hole, last);
+		_reheapUp(heap, hole);
+	}
+
+	return root;
+}
+
+/* Deletes root of heap and passes its key and payload back to caller
+payload may be NULL if not needed
+return 1 if successful; 0 if heap empty
+*/
+int heapDelete(HEAP *heap, int *key, void **payload)
+{
+	if (heap == NULL || heap->last < 0)
+		return 0;
+
+	ELEMENT root;
+
+	if (heap->radix != NULL)
+	{
+		if (!_radixRemove(heap, &root))
+			return 0;
+	}
+
+	else
+	{
+		root = _removeRoot(heap);
+		_releaseHandle(heap, root.handle);
+	}
+
+	*key = root.key;
+	if (payload != NULL)
+		*payload = root.payload;
+
+	return 1;
+}
+
+/* Reestablishes heap after the key at index changed from oldKey
+*/
+static void _reheap(HEAP *heap, int index, int oldKey)
+{
+	if (heap->compare(heap->heapArr[index].key, oldKey) > 0)
+		_reheapUp(heap, index);
+
+	else
+		_reheapDown(heap, index);
+}
+
+/* Changes the key of the element named by handle in an indexed heap
+return 1 if successful; 0 if handle invalid
+*/
+int heapUpdate(HEAP *heap, int handle, int key)
+{
+	int index = _lookupHandle(heap, handle);
+
+	if (index < 0)
+		return 0;
+
+	int oldKey = heap->heapArr[index].key;
+	heap->heapArr[index].key = key;
+
+	_reheap(heap, index, oldKey);
+
+	return 1;
+}
+
+/* Deletes the element named by handle from an indexed heap
+and passes its key and payload back to caller (payload may be NULL)
+return 1 if successful; 0 if handle invalid
+*/
+int heapRemove(HEAP *heap, int handle, int *key, void **payload)
+{
+	int index = _lookupHandle(heap, handle);
+
+	if (index < 0)
+		return 0;
+
+	ELEMENT elem = heap->heapArr[index];
+	ELEMENT last = heap->heapArr[(heap->last)--];
+
+	// the last element takes the freed slot and moves either way
+	if (index <= heap->last)
+	{
+		_place(heap, index, last);
+		_reheap(heap, index, elem.key);
+	}
+
+	_releaseHandle(heap, handle);
+
+	*key = elem.key;
+	if (payload != NULL)
+		*payload = elem.payload;
+
+	return 1;
+}
+
+/* Reestablishes heap order over the whole array bottom-up in O(n)
+*/
+static void _heapify(HEAP *heap)
+{
+	for (int i = (heap->last - 1) / HEAP_DEGREE; i >= 0; i--)
+		_reheapDown(heap, i);
+}
+
+/* Allocates memory for heap and fills it with n elements of array in O(n)
+if memory overflow, NULL returned
+*/
+HEAP *heapBuild(ELEMENT array[], int n, int (*compare)(int, int))
+{
+	HEAP *heap = heapCreate(n, compare);
+
+	if (heap == NULL)
+		return NULL;
+
+	memcpy(heap->heapArr, array, n * sizeof(ELEMENT));
+	heap->last = n - 1;
+
+	_heapify(heap);
+
+	return heap;
+}
+
+/* Uses array itself as heap storage (no allocation)
+*/
+static HEAP _wrapArray(ELEMENT array[], int n, int (*compare)(int, int))
+{
+	HEAP heap;
+
+	heap.heapArr = array;
+	heap.block = NULL;
+	heap.last = n - 1;
+	heap.capacity = n;
+	heap.compare = compare;
+	heap.position = NULL;
+	heap.freeHandles = NULL;
+	heap.nFree = heap.nHandles = 0;
+	heap.radix = NULL;
+
+	return heap;
+}
+
+/* Moves the k highest priority elements of array to array[n - k] .. array[n - 1]
+in increasing priority (the highest is array[n - 1]); the rest is left in heap order
+O(n + k log n), in place
+*/
+void heapSelect(ELEMENT array[], int n, int k, int (*compare)(int, int))
+{
+	HEAP heap = _wrapArray(array, n, compare);
+
+	if (k > n)
+		k = n;
+
+	_heapify(&heap);
+
+	for (int i = 0; i < k; i++)
+	{
+		ELEMENT root = _removeRoot(&heap);
+		heap.heapArr[heap.last + 1] = root;
+	}
+}
+
+/* Sorts array in place in increasing priority
+(ascending keys with maxCompare, descending with minCompare)
+*/
+void heapSort(ELEMENT array[], int n, int (*compare)(int, int))
+{
+	heapSelect(array, n, n, compare);
+}
+
+/* Print heap array (bucket by bucket for radix heap) */
+void heapPrint(HEAP *heap)
+{
+	if (heap == NULL)
+		return;
+
+	if (heap->radix != NULL)
+	{
+		for (int i = 0; i < RADIX_BUCKETS; i++)
+			for (int j = 0; j < heap->radix->buckets[i].size; j++)
+				printf("%6d", heap->radix->buckets[i].elems[j].key);
+	}
+
+	else
+		for (int i = 0; i <= heap->last; i++)
+			printf("%6d", heap->heapArr[i].key);
+
+	printf("\n");
+
+	if (heap->radix == NULL && heap->last == heap->capacity - 1)
+		printf("\n");
+}
+
+#if CONCURRENT
+////////////////////////////////////////////////////////////////////////////////
+// MultiQueue: concurrent priority queue made of several locked heaps
+// inserts go to a random heap; deletes take the better root of two random heaps,
+// so a delete returns one of the highest priority elements (not always the highest)
+#define MQ_FACTOR 2 // heaps per thread
+
+typedef struct
+{
+	_Alignas(CACHE_LINE) pthread_mutex_t lock; // one heap per cache line
+	HEAP *heap;
+	atomic_int top;	 // key of root, readable without the lock
+	atomic_int size; // number of elements, readable without the lock
+} MQ_QUEUE;
+
+typedef struct
+{
+	MQ_QUEUE *queues;
+	int nQueues;
+	int (*compare)(int, int);
+} MQ;
+
+/* Per-thread xorshift random number
+*/
+static unsigned int _random(void)
+{
+	static _Thread_local unsigned int state = 0;
+
+	if (state == 0)
+		state = (unsigned int)(uintptr_t)&state | 1; // differs per thread
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return state;
+}
+
+/* Free memory for MultiQueue
+*/
+void mqDestroy(MQ *mq)
+{
+	if (mq == NULL)
+		return;
+
+	for (int i = 0; i < mq->nQueues; i++)
+	{
+		pthread_mutex_destroy(&mq->queues[i].lock);
+		heapDestroy(mq->queues[i].heap);
+	}
+
+	free(mq->queues);
+	free(mq);
+}
+
+/* Allocates memory for a MultiQueue of nQueues heaps
+if memory overflow, NULL returned
+*/
+MQ *mqCreate(int nQueues, int (*compare)(int, int))
+{
+	MQ *temp = malloc(sizeof(MQ));
+
+	if (temp == NULL)
+		return NULL;
+
+	temp->queues = aligned_alloc(CACHE_LINE, nQueues * sizeof(MQ_QUEUE));
+	if (temp->queues == NULL)
+	{
+		free(temp);
+		return NULL;
+	}
+
+	temp->nQueues = nQueues;
+	temp->compare = compare;
+
+	for (int i = 0; i < nQueues; i++)
+	{
+		MQ_QUEUE *q = &temp->queues[i];
+
+		// queues [0, i) are complete, so mqDestroy only unwinds those
+		q->heap = heapCreate(MAX_ELEM, compare);
+		if (q->heap == NULL)
+		{
+			temp->nQueues = i;
+			mqDestroy(temp);
+			return NULL;
+		}
+
+		pthread_mutex_init(&q->lock, NULL);
+		atomic_init(&q->top, 0);
+		atomic_init(&q->size, 0);
+	}
+
+	return temp;
+}
+
+/* Publishes root and size of a locked queue for lock-free readers
+*/
+static void _publish(MQ_QUEUE *q)
+{
+	if (q->heap->last >= 0)
+		atomic_store_explicit(&q->top, q->heap->heapArr[0].key, memory_order_relaxed);
+
+	atomic_store_explicit(&q->size, q->heap->last + 1, memory_order_relaxed);
+}
+
+/* Inserts key with its payload into a random heap that is not locked
+return 1 if successful; 0 if memory overflow
+*/
+int mqInsert(MQ *mq, int key, void *payload)
+{
+	MQ_QUEUE *q;
+
+	do
+		q = &mq->queues[_random() % mq->nQueues];
+	while (pthread_mutex_trylock(&q->lock) != 0);
+
+	int ret = heapInsert(q->heap, key, payload);
+	_publish(q);
+
+	pthread_mutex_unlock(&q->lock);
+
+	return ret;
+}
+
+/* return 1 if every heap looks empty; 0 if not
+*/
+static int _mqEmpty(MQ *mq)
+{
+	for (int i = 0; i < mq->nQueues; i++)
+		if (atomic_load_explicit(&mq->queues[i].size, memory_order_relaxed) > 0)
+			return 0;
+
+	return 1;
+}
+
+/* Deletes the root of the better of two random heaps and passes its key and payload back to caller
+payload may be NULL if not needed
+return 1 if successful; 0 if all heaps empty
+*/
+int mqDelete(MQ *mq, int *key, void **payload)
+{
+	for (int attempt = 1;; attempt++)
+	{
+		MQ_QUEUE *q = &mq->queues[_random() % mq->nQueues];
+		MQ_QUEUE *other = &mq->queues[_random() % mq->nQueues];
+
+		int qSize = atomic_load_explicit(&q->size, memory_order_relaxed);
+		int otherSize = atomic_load_explicit(&other->size, memory_order_relaxed);
+
+		if (qSize == 0 ||
+			(otherSize > 0 && mq->compare(atomic_load_explicit(&other->top, memory_order_relaxed),
+										  atomic_load_explicit(&q->top, memory_order_relaxed)) > 0))
+			q = other;
+
+		if (atomic_load_explicit(&q->size, memory_order_relaxed) == 0)
+		{
+			// after many misses make sure there is anything left at all
+			if (attempt % mq->nQueues == 0 && _mqEmpty(mq))
+				return 0;
+
+			continue;
+		}
+
+		if (pthread_mutex_trylock(&q->lock) != 0)
+			continue;
+
+		int ret = heapDelete(q->heap, key, payload);
+		_publish(q);
+
+		pthread_mutex_unlock(&q->lock);
+
+		if (ret)
+			return 1;
+	}
+}
+
+// single heap behind one global lock, the baseline for the benchmark
+typedef struct
+{
+	pthread_mutex_t lock;
+	HEAP *heap;
+} LOCKED_HEAP;
+
+static int _lockedInsert(void *queue, int key)
+{
+	LOCKED_HEAP *locked = queue;
+
+	pthread_mutex_lock(&locked->lock);
+	int ret = heapInsert(locked->heap, key, NULL);
+	pthread_mutex_unlock(&locked->lock);
+
+	return ret;
+}
+
+static int _lockedDelete(void *queue, int *key)
+{
+	LOCKED_HEAP *locked = queue;
+
+	pthread_mutex_lock(&locked->lock);
+	int ret = heapDelete(locked->heap, key, NULL);
+	pthread_mutex_unlock(&locked->lock);
+
+	return ret;
+}
+
+static int _mqInsert(void *queue, int key)
+{
+	return mqInsert(queue, key, NULL);
+}
+
+static int _mqDelete(void *queue, int *key)
+{
+	return mqDelete(queue, key, NULL);
+}
+
+typedef struct
+{
+	void *queue;
+	int (*insert)(void *, int);
+	int (*delete)(void *, int *);
+	int ops;
+} WORKER;
+
+/* Benchmark thread: alternating insert and delete of random keys
+*/
+static void *_worker(void *arg)
+{
+	WORKER *worker = arg;
+	int key;
+
+	for (int i = 0; i < worker->ops; i++)
+	{
+		worker->insert(worker->queue, _random() % (1 << 20));
+		worker->delete(worker->queue, &key);
+	}
+
+	return NULL;
+}
+
+/* Runs nThreads workers sharing totalOps insert/delete pairs on queue
+return throughput in million operations per second
+-1 if a thread could not be started (the started ones are joined)
+*/
+static double _runWorkers(void *queue, int (*insert)(void *, int), int (*delete)(void *, int *), int nThreads, int totalOps)
+{
+	pthread_t threads[nThreads];
+	WORKER worker = {queue, insert, delete, totalOps / nThreads};
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	int started = 0;
+	while (started < nThreads && pthread_create(&threads[started], NULL, _worker, &worker) == 0)
+		started++;
+	for (int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (started < nThreads)
+		return -1;
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	return 2.0 * worker.ops * nThreads / seconds / 1e6;
+}
+
+/* Compares MultiQueue with one globally locked heap for 1 ~ 32 threads
+*/
+static void _scalingBenchmark(void)
+{
+	const int prefill = 1 << 20, totalOps = 1 << 22;
+
+	for (int nThreads = 1; nThreads <= 32; nThreads *= 2)
+	{
+		LOCKED_HEAP locked;
+		pthread_mutex_init(&locked.lock, NULL);
+		locked.heap = heapCreate(prefill, maxCompare);
+
+		MQ *mq = mqCreate(MQ_FACTOR * nThreads, maxCompare);
+
+		int ok = (locked.heap != NULL && mq != NULL);
+		if (!ok)
+			fprintf(stderr, "Memory allocation error!\n");
+
+		for (int i = 0; i < prefill && ok; i++)
+		{
+			int key = _random() % (1 << 20);
+			heapInsert(locked.heap, key, NULL);
+			mqInsert(mq, key, NULL);
+		}
+
+		if (ok)
+		{
+			double lockedRate = _runWorkers(&locked, _lockedInsert, _lockedDelete, nThreads, totalOps);
+			double mqRate = (lockedRate < 0) ? -1 : _runWorkers(mq, _mqInsert, _mqDelete, nThreads, totalOps);
+
+			ok = (mqRate >= 0);
+			if (ok)
+				printf("threads %2d  global lock %8.2f Mops/s  MultiQueue %8.2f Mops/s\n", nThreads, lockedRate, mqRate);
+			else
+				fprintf(stderr, "Cannot start %d threads!\n", nThreads);
+		}
+
+		heapDestroy(locked.heap);
+		pthread_mutex_destroy(&locked.lock);
+		mqDestroy(mq);
+
+		if (!ok)
+			return;
+	}
+}
+#endif
+
+#if BENCHMARK
+/* Previous swap-based recursive versions, kept only for comparison
+*/
+static void _reheapUpSwap(HEAP *heap, int index)
+{
+	if (index == 0)
+		return;
+
+	if (heap->compare(heap->heapArr[index].key, heap->heapArr[(index - 1) / 2].key) > 0)
 	{
-		left = heap->heapArr[index * 2 + 1];
+		ELEMENT temp = heap->heapArr[index];
+		heap->heapArr[index] = heap->heapArr[(index - 1) / 2];
+		heap->heapArr[(index - 1) / 2] = temp;
+
+		_reheapUpSwap(heap, (index - 1) / 2);
+	}
+}
 
-		if (index * 2 + 2 <= heap->last)
-			right = heap->heapArr[index * 2 + 2];
+static void _reheapDownSwap(HEAP *heap, int index)
+{
+	int subtree;
 
-		if (left > right)
-			subtree = index * 2 + 1;
+	if (index * 2 + 1 <= heap->last)
+	{
+		subtree = index * 2 + 1;
 
-		else
+		if (index * 2 + 2 <= heap->last &&
+			heap->compare(heap->heapArr[index * 2 + 1].key, heap->heapArr[index * 2 + 2].key) <= 0)
 			subtree = index * 2 + 2;
 
-		if (heap->heapArr[index] < heap->heapArr[subtree])
+		if (heap->compare(heap->heapArr[subtree].key, heap->heapArr[index].key) > 0)
 		{
-			int temp = heap->heapArr[index];
+			ELEMENT temp = heap->heapArr[index];
 			heap->heapArr[index] = heap->heapArr[subtree];
 			heap->heapArr[subtree] = temp;
 
-			_reheapDown(heap, subtree);
+			_reheapDownSwap(heap, subtree);
 		}
 	}
 }
 
-/* Deletes root of heap and passes data back to caller
-return 1 if successful; 0 if heap empty
-*/
-int heapDelete(HEAP *heap, int *data)
+static int heapInsertSwap(HEAP *heap, int key, void *payload)
 {
-	if (heap == NULL)
+	if (heap->last == heap->capacity - 1 && !_grow(heap))
 		return 0;
 
-	*data = heap->heapArr[0];
+	ELEMENT *elem = &heap->heapArr[++(heap->last)];
+	elem->key = key;
+	elem->payload = payload;
 
-	int temp = heap->heapArr[0];
+	_reheapUpSwap(heap, heap->last);
+
+	return 1;
+}
+
+static int heapDeleteSwap(HEAP *heap, int *key, void **payload)
+{
+	if (heap->last < 0)
+		return 0;
+
+	*key = heap->heapArr[0].key;
+	if (payload != NULL)
+		*payload = heap->heapArr[0].payload;
+
+	ELEMENT temp = heap->heapArr[0];
 	heap->heapArr[0] = heap->heapArr[heap->last];
 	heap->heapArr[heap->last] = temp;
 
 	(heap->last)--;
 
-	_reheapDown(heap, 0);
+	_reheapDownSwap(heap, 0);
 
 	return 1;
 }
 
-/* Print heap array */
-void heapPrint(HEAP *heap)
+/* Times n inserts followed by n deletes with random keys
+*/
+static void _benchmark(const char *name, int (*insert)(HEAP *, int, void *), int (*delete)(HEAP *, int *, void **), int n)
 {
-	if (heap == NULL)
-		return;
+	HEAP *heap = heapCreate(n, maxCompare);
+	int key;
 
-	for (int i = 0; i <= heap->last; i++)
-		printf("%6d", heap->heapArr[i]);
+	srand(n);
 
-	printf("\n");
+	clock_t start = clock();
+	for (int i = 0; i < n; i++)
+		insert(heap, rand(), NULL);
 
-	if (heap->last == heap->capacity - 1)
-		printf("\n");
+	clock_t middle = clock();
+	while (delete(heap, &key, NULL))
+		;
+
+	clock_t end = clock();
+
+	printf("%-6s n = %9d  push %8.2f Mops/s  pop %8.2f Mops/s\n", name, n,
+		   n / 1e6 / ((double)(middle - start) / CLOCKS_PER_SEC),
+		   n / 1e6 / ((double)(end - middle) / CLOCKS_PER_SEC));
+
+	heapDestroy(heap);
 }
+#endif
 
 int main(void)
 {
+#if CONCURRENT
+	_scalingBenchmark();
+
+	return 0;
+#endif
+
+#if BENCHMARK
+	for (int n = 1000; n <= 10000000; n *= 10)
+	{
+		_benchmark("swap", heapInsertSwap, heapDeleteSwap, n);
+		_benchmark("hole", heapInsert, heapDelete, n);
+	}
+
+	return 0;
+#endif
+
 	HEAP *heap;
 	int data;
 	int i;
 
-	heap = heapCreate(MAX_ELEM);
-
 	srand(time(NULL));
 
+#if BULK_LOAD
+	ELEMENT array[MAX_ELEM];
+
+	fprintf(stdout, "Building:");
+	for (i = 0; i < MAX_ELEM; i++)
+	{
+		array[i].key = rand() % MAX_ELEM * 3 + 1; // 1 ~ MAX_ELEM*3 random number
+		array[i].payload = NULL;
+
+		fprintf(stdout, " %d", array[i].key);
+	}
+	fprintf(stdout, "\n");
+
+	heap = heapBuild(array, MAX_ELEM, maxCompare);
+
+	fprintf(stdout, "Heap: ");
+	heapPrint(heap);
+#else
+#if RADIX_HEAP
+	heap = heapCreateRadix(MAX_ELEM * 3, maxCompare);
+#else
+	heap = heapCreate(MAX_ELEM, maxCompare);
+#endif
+
 	for (i = 0; i < MAX_ELEM; i++)
 	{
 		data = rand() % MAX_ELEM * 3 + 1; // 1 ~ MAX_ELEM*3 random number
@@ -161,15 +1204,16 @@ int main(void)
 		fprintf(stdout, "Inserting %d: ", data);
 
 		// insert function call
-		heapInsert(heap, data);
+		heapInsert(heap, data, NULL);
 
 		heapPrint(heap);
 	}
+#endif
 
 	while (heap->last >= 0)
 	{
 		// delete function call
-		heapDelete(heap, &data);
+		heapDelete(heap, &data, NULL);
 
 		printf("Deleting %d: ", data);
 
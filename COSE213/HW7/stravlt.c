@@ -1,29 +1,72 @@
 #define SHOW_STEP 0
-#define BALANCING 1 // used in _insert function
+#define BALANCING 1 // used in _balance function
+#define UPSERT 0	// inserting an existing key increases its counter instead of adding a node
+#define BULK_LOAD 0 // build the tree in main from the whole list of words at once
+#define CONCURRENT 0 // multi-threaded lookup benchmark instead of the queries (link with -pthread)
 
-#include <stdlib.h> // malloc, rand
+#include <stdlib.h> // malloc, aligned_alloc, rand
 #include <stdio.h>
 #include <time.h>	// time
 #include <string.h> //strcmp, strdup
 
+#if CONCURRENT
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h> // uintptr_t, intptr_t
+#endif
+
 #define max(x, y) (((x) > (y)) ? (x) : (y))
 
+#define INLINE_KEY 24	   // keys shorter than this are stored inside the node
+#define NODES_PER_CHUNK 1024 // nodes allocated at once by the node pool
+#define AVL_MAX_HEIGHT 64	   // length of the path stack of AVL_Insert
+#define CACHE_LINE 64
+
 ////////////////////////////////////////////////////////////////////////////////
 // AVL_TREE type definition
+// 64 bytes: a node and its key fit in one cache line
 typedef struct node
 {
-	char *data;
+	unsigned long long prefix; // first 8 bytes of the key packed in comparison order
 	struct node *left;
 	struct node *right;
 	int height;
+	int count;	// occurrences of the key (greater than 1 only in UPSERT mode)
+	int length; // length of the key
+	union
+	{
+		char str[INLINE_KEY]; // key if length < INLINE_KEY
+		char *ptr;			  // key otherwise
+	} key;
 } NODE;
 
+// chunks are allocated on cache line boundaries so that no node straddles two lines
+typedef struct chunk
+{
+	_Alignas(CACHE_LINE) NODE nodes[NODES_PER_CHUNK];
+	struct chunk *next;
+} CHUNK;
+
 typedef struct
 {
 	NODE *root;
 	int count; // number of nodes
+
+	// node pool
+	CHUNK *chunks;
+	NODE *freeNodes; // recycled nodes linked by left
+	int used;		 // nodes handed out from the newest chunk
 } AVL_TREE;
 
+// in-order scan of the keys from a lower bound
+typedef struct
+{
+	NODE **stack; // nodes whose key and right subtree are still to be visited
+	int top;
+	const char *end; // upper bound (exclusive) or prefix; NULL if unbounded
+	int prefixLength; // 0 if end is an upper bound
+} AVL_ITER;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Prototype declarations
 
@@ -40,10 +83,50 @@ AVL_TREE *AVL_Create(void)
 
 	temp->root = NULL;
 	temp->count = 0;
+	temp->chunks = NULL;
+	temp->freeNodes = NULL;
+	temp->used = NODES_PER_CHUNK;
 
 	return temp;
 }
 
+/* internal function
+	return	key stored in the node
+*/
+static inline char *_key(NODE *node)
+{
+	return (node->length < INLINE_KEY) ? node->key.str : node->key.ptr;
+}
+
+/* internal function
+	Packs up to the first 8 bytes of str so that comparing the numbers
+	orders them like strcmp
+*/
+static unsigned long long _prefix(const char *str)
+{
+	unsigned long long prefix = 0;
+	int i;
+
+	for (i = 0; i < 8 && str[i] != '\0'; i++)
+		prefix = (prefix << 8) | (unsigned char)str[i];
+
+	// an empty key would shift by 64 bits
+	return (i == 0) ? 0 : prefix << (8 * (8 - i));
+}
+
+/* internal function
+	Compares key (with its prefix) to the key of node
+	strcmp is needed only if the prefixes are equal
+	return	negative, 0 or positive like strcmp
+*/
+static inline int _compare(const char *key, unsigned long long prefix, NODE *node)
+{
+	if (prefix != node->prefix)
+		return (prefix < node->prefix) ? -1 : 1;
+
+	return strcmp(key, _key(node));
+}
+
 static void _destroy(NODE *root)
 {
 	if (root == NULL)
@@ -52,8 +135,8 @@ static void _destroy(NODE *root)
 	_destroy(root->left);
 	_destroy(root->right);
 
-	free(root->data);
-	free(root);
+	if (root->length >= INLINE_KEY)
+		free(root->key.ptr);
 }
 
 /* Deletes all data in tree and recycles memory
@@ -62,23 +145,79 @@ void AVL_Destroy(AVL_TREE *pTree)
 {
 	_destroy(pTree->root);
 
+	while (pTree->chunks != NULL)
+	{
+		CHUNK *next = pTree->chunks->next;
+		free(pTree->chunks);
+		pTree->chunks = next;
+	}
+
 	free(pTree);
 }
 
-static NODE *_makeNode(char *data)
+/* internal function
+	Takes a node from the pool of the tree
+*/
+static NODE *_allocNode(AVL_TREE *pTree)
+{
+	if (pTree->freeNodes != NULL)
+	{
+		NODE *temp = pTree->freeNodes;
+		pTree->freeNodes = temp->left;
+		return temp;
+	}
+
+	if (pTree->used == NODES_PER_CHUNK)
+	{
+		CHUNK *chunk = (CHUNK *)aligned_alloc(CACHE_LINE, sizeof(CHUNK));
+		if (chunk == NULL)
+			return NULL;
+
+		chunk->next = pTree->chunks;
+		pTree->chunks = chunk;
+		pTree->used = 0;
+	}
+
+	return &pTree->chunks->nodes[(pTree->used)++];
+}
+
+/* internal function
+	Returns a node and its key to the pool of the tree
+*/
+static void _freeNode(AVL_TREE *pTree, NODE *node)
+{
+	if (node->length >= INLINE_KEY)
+		free(node->key.ptr);
+
+	node->left = pTree->freeNodes;
+	pTree->freeNodes = node;
+}
+
+static NODE *_makeNode(AVL_TREE *pTree, char *data)
 {
-	NODE *temp = (NODE *)malloc(sizeof(NODE));
+	NODE *temp = _allocNode(pTree);
 	if (temp == NULL)
 		return NULL;
 
-	temp->data = strdup(data);
-	if (temp->data == NULL)
+	temp->length = strlen(data);
+
+	if (temp->length < INLINE_KEY)
+		memcpy(temp->key.str, data, temp->length + 1);
+
+	else
 	{
-		free(temp);
-		return NULL;
+		temp->key.ptr = strdup(data);
+		if (temp->key.ptr == NULL)
+		{
+			temp->length = 0;
+			_freeNode(pTree, temp);
+			return NULL;
+		}
 	}
 
+	temp->prefix = _prefix(data);
 	temp->height = 1;
+	temp->count = 1;
 	temp->left = temp->right = NULL;
 
 	return temp;
@@ -132,22 +271,11 @@ static NODE *rotateLeft(NODE *root)
 }
 
 /* internal function
-	This function uses recursion to insert the new data into a leaf node
-	return	pointer to new root
+	Updates height of the node and rotates the subtree if it is out of balance
+	return	new root
 */
-static NODE *_insert(NODE *root, NODE *newPtr)
+static NODE *_balance(NODE *root)
 {
-	if (root == NULL)
-		return newPtr;
-
-	int res = strcmp(newPtr->data, root->data);
-
-	if (res < 0)
-		root->left = _insert(root->left, newPtr);
-
-	else
-		root->right = _insert(root->right, newPtr);
-
 	root->height = max(getHeight(root->left), getHeight(root->right)) + 1;
 
 #if BALANCING
@@ -159,7 +287,8 @@ static NODE *_insert(NODE *root, NODE *newPtr)
 		int subLHeight = getHeight(root->left->left);
 		int subRHeight = getHeight(root->left->right);
 
-		if (max(subRHeight, subLHeight) == subRHeight)
+		// equal heights only occur after a delete and need a single rotation
+		if (subRHeight > subLHeight)
 			root->left = rotateLeft(root->left);
 
 		root = rotateRight(root);
@@ -170,7 +299,7 @@ static NODE *_insert(NODE *root, NODE *newPtr)
 		int subLHeight = getHeight(root->right->left);
 		int subRHeight = getHeight(root->right->right);
 
-		if (max(subLHeight, subRHeight) == subLHeight)
+		if (subLHeight > subRHeight)
 			root->right = rotateRight(root->right);
 
 		root = rotateLeft(root);
@@ -181,42 +310,190 @@ static NODE *_insert(NODE *root, NODE *newPtr)
 }
 
 /* Inserts new data into the tree
+	The path is recorded in a stack of links and rebalancing stops at the
+	first node whose height does not change
+	the node is allocated only when the data is not found (in UPSERT mode)
 	return	1 success
 			0 overflow
 */
 int AVL_Insert(AVL_TREE *pTree, char *data)
 {
-	NODE *newNode = _makeNode(data);
+	NODE **stack[AVL_MAX_HEIGHT];
+	NODE ***path = stack;
+	NODE **link = &pTree->root;
+	unsigned long long prefix = _prefix(data);
+	int top = 0;
+
+	// only possible without BALANCING
+	if (pTree->root != NULL && pTree->root->height >= AVL_MAX_HEIGHT)
+	{
+		path = (NODE ***)malloc(sizeof(NODE **) * pTree->root->height);
+		if (path == NULL)
+			return 0;
+	}
+
+	while (*link != NULL)
+	{
+		int res = _compare(data, prefix, *link);
+
+#if UPSERT
+		if (res == 0)
+		{
+			((*link)->count)++;
+			if (path != stack)
+				free(path);
+			return 1;
+		}
+#endif
 
-	if (newNode == NULL)
+		path[top++] = link;
+		link = (res < 0) ? &(*link)->left : &(*link)->right;
+	}
+
+	*link = _makeNode(pTree, data);
+	if (*link == NULL)
+	{
+		if (path != stack)
+			free(path);
 		return 0;
+	}
 
-	pTree->root = _insert(pTree->root, newNode);
 	(pTree->count)++;
 
+	while (top > 0)
+	{
+		link = path[--top];
+
+		int height = (*link)->height;
+		*link = _balance(*link);
+
+		// a rotation restores the old height, so the ancestors are unchanged
+		if ((*link)->height == height)
+			break;
+	}
+
+	if (path != stack)
+		free(path);
+
 	return 1;
 }
 
 /* internal function
-	Retrieve node containing the requested key
-	return	address of the node containing the key
-			NULL not found
+	Detaches the node with the smallest key from the (sub)tree
+	min receives the detached node
+	return	pointer to new root
+*/
+static NODE *_deleteMin(NODE *root, NODE **min)
+{
+	if (root->left == NULL)
+	{
+		*min = root;
+		return root->right;
+	}
+
+	root->left = _deleteMin(root->left, min);
+
+	return _balance(root);
+}
+
+/* internal function
+	This function uses recursion to delete the node containing dltKey
+	success is 1 if deleted; 0 if not found
+	return	pointer to new root
 */
-static NODE *_retrieve(NODE *root, char *key)
+static NODE *_delete(AVL_TREE *pTree, NODE *root, char *dltKey, unsigned long long prefix, int *success)
 {
 	if (root == NULL)
+	{
+		*success = 0;
 		return NULL;
+	}
 
-	int res = strcmp(key, root->data);
+	int res = _compare(dltKey, prefix, root);
 
-	if (res == 0)
-		return root;
+	if (res < 0)
+		root->left = _delete(pTree, root->left, dltKey, prefix, success);
 
 	else if (res > 0)
-		return _retrieve(root->right, key);
+		root->right = _delete(pTree, root->right, dltKey, prefix, success);
+
+	else if (root->count > 1)
+	{
+		(root->count)--;
+		*success = 2;
+		return root;
+	}
 
 	else
-		return _retrieve(root->left, key);
+	{
+		NODE *delNode = root;
+
+		if (root->left == NULL)
+			root = root->right;
+
+		else if (root->right == NULL)
+			root = root->left;
+
+		else
+		{
+			// the successor node takes the place of the deleted node
+			NODE *min;
+			NODE *right = _deleteMin(root->right, &min);
+
+			min->left = root->left;
+			min->right = right;
+			root = min;
+		}
+
+		_freeNode(pTree, delNode);
+
+		*success = 1;
+
+		if (root == NULL)
+			return NULL;
+	}
+
+	if (*success != 1)
+		return root;
+
+	return _balance(root);
+}
+
+/* Deletes the node containing dltKey from the tree
+	(in UPSERT mode only decreases its counter while it is greater than 1)
+	return	1 success
+			0 not found
+*/
+int AVL_Delete(AVL_TREE *pTree, char *dltKey)
+{
+	int success = 0;
+
+	pTree->root = _delete(pTree, pTree->root, dltKey, _prefix(dltKey), &success);
+
+	if (success == 1)
+		(pTree->count)--;
+
+	return success != 0;
+}
+
+/* internal function
+	Retrieve node containing the requested key
+	return	address of the node containing the key
+			NULL not found
+*/
+static NODE *_retrieve(NODE *root, char *key, unsigned long long prefix)
+{
+	while (root != NULL)
+	{
+		int res = _compare(key, prefix, root);
+
+		if (res == 0)
+			return root;
+
+		root = (res > 0) ? root->right : root->left;
+	}
+
+	return NULL;
 }
 
 /* Retrieve tree for the node containing the requested key
@@ -225,117 +502,1027 @@ static NODE *_retrieve(NODE *root, char *key)
 */
 char *AVL_Retrieve(AVL_TREE *pTree, char *key)
 {
-	NODE *res = _retrieve(pTree->root, key);
+	NODE *res = _retrieve(pTree->root, key, _prefix(key));
 
 	if (res == NULL)
 		return NULL;
 
-	return res->data;
+	return _key(res);
 }
 
-static void _traverse(NODE *root)
+/* internal function
+	Links nodes[first .. last] into a balanced subtree and sets their heights
+	return	pointer to root
+*/
+static NODE *_build(NODE *nodes[], int first, int last)
 {
-	if (root == NULL)
-		return;
+	if (first > last)
+		return NULL;
 
-	_traverse(root->left);
-	printf("%s ", root->data);
-	_traverse(root->right);
+	int mid = first + (last - first) / 2;
+	NODE *root = nodes[mid];
+
+	root->left = _build(nodes, first, mid - 1);
+	root->right = _build(nodes, mid + 1, last);
+	root->height = max(getHeight(root->left), getHeight(root->right)) + 1;
+
+	return root;
 }
 
-/* Prints tree using inorder traversal
+static int _compareWords(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Builds a balanced tree holding the n words
+	sorted input is detected and built in O(n); other input is sorted first
+	return	tree pointer
+			NULL if overflow
 */
-void AVL_Traverse(AVL_TREE *pTree)
+AVL_TREE *AVL_BuildFrom(char *words[], int n)
 {
-	_traverse(pTree->root);
+	AVL_TREE *temp = AVL_Create();
+	if (temp == NULL)
+		return NULL;
+
+	if (n <= 0)
+		return temp;
+
+	char **sorted = (char **)malloc(n * sizeof(char *));
+	NODE **nodes = (NODE **)malloc(n * sizeof(NODE *));
+
+	if (sorted == NULL || nodes == NULL)
+	{
+		free(sorted);
+		free(nodes);
+		AVL_Destroy(temp);
+		return NULL;
+	}
+
+	memcpy(sorted, words, n * sizeof(char *));
+
+	for (int i = 1; i < n; i++)
+		if (strcmp(sorted[i - 1], sorted[i]) > 0)
+		{
+			qsort(sorted, n, sizeof(char *), _compareWords);
+			break;
+		}
+
+	int count = 0;
+	for (int i = 0; i < n; i++)
+	{
+#if UPSERT
+		if (count > 0 && strcmp(_key(nodes[count - 1]), sorted[i]) == 0)
+		{
+			(nodes[count - 1]->count)++;
+			continue;
+		}
+#endif
+		nodes[count] = _makeNode(temp, sorted[i]);
+		if (nodes[count] == NULL)
+		{
+			while (count > 0)
+				_freeNode(temp, nodes[--count]);
+
+			free(sorted);
+			free(nodes);
+			AVL_Destroy(temp);
+			return NULL;
+		}
+
+		count++;
+	}
+
+	temp->root = _build(nodes, 0, count - 1);
+	temp->count = count;
+
+	free(sorted);
+	free(nodes);
+
+	return temp;
 }
 
-/* internal traversal function
+/* internal function
+	Starts a scan from the first key that is not less than lo
+	the stack is sized by the height of the tree, so it never grows
+	return	1 success
+			0 overflow
 */
-static void _infix_print(NODE *root, int level)
+static int _seek(AVL_TREE *pTree, const char *lo, AVL_ITER *iter)
 {
-	if (root == NULL)
-		return;
+	iter->top = 0;
+	iter->stack = (NODE **)malloc((getHeight(pTree->root) + 1) * sizeof(NODE *));
+	if (iter->stack == NULL)
+		return 0;
 
-	_infix_print(root->right, level + 1);
-	for (int i = 0; i < level; i++)
-		printf("\t");
-	printf("%s\n", root->data);
-	_infix_print(root->left, level + 1);
+	unsigned long long prefix = _prefix(lo);
+
+	// keep only the nodes on the search path for lo that are not below it
+	for (NODE *root = pTree->root; root != NULL;)
+	{
+		if (_compare(lo, prefix, root) <= 0)
+		{
+			iter->stack[(iter->top)++] = root;
+			root = root->left;
+		}
+
+		else
+			root = root->right;
+	}
+
+	return 1;
 }
 
-/* Prints tree using inorder right-to-left traversal
+/* Starts a scan of keys in [lo, hi) in ascending order
+	hi may be NULL for no upper bound; lo and hi must live until the scan ends
+	return	1 success
+			0 overflow
 */
-void printTree(AVL_TREE *pTree)
+int AVL_RangeBegin(AVL_TREE *pTree, const char *lo, const char *hi, AVL_ITER *iter)
 {
-	_infix_print(pTree->root, 0);
+	iter->end = hi;
+	iter->prefixLength = 0;
+
+	return _seek(pTree, lo, iter);
 }
 
-////////////////////////////////////////////////////////////////////////////////
-int main(int argc, char **argv)
+/* Starts a scan of keys beginning with prefix in ascending order
+	prefix must live until the scan ends
+	return	1 success
+			0 overflow
+*/
+int AVL_PrefixBegin(AVL_TREE *pTree, const char *prefix, AVL_ITER *iter)
 {
-	AVL_TREE *tree;
-	char str[1024];
+	iter->prefixLength = strlen(prefix);
+	iter->end = (iter->prefixLength > 0) ? prefix : NULL;
 
-	if (argc != 2)
-	{
-		fprintf(stderr, "Usage: %s FILE\n", argv[0]);
-		return 0;
-	}
+	return _seek(pTree, prefix, iter);
+}
 
-	// creates a null tree
-	tree = AVL_Create();
+/* Passes the next key of the scan back to caller
+	return	address of the key
+			NULL if the scan is exhausted
+*/
+char *AVL_Next(AVL_ITER *iter)
+{
+	if (iter->top == 0)
+		return NULL;
 
-	if (!tree)
-	{
-		fprintf(stderr, "Cannot create tree!\n");
-		return 100;
-	}
+	NODE *node = iter->stack[--(iter->top)];
+	char *key = _key(node);
 
-	FILE *fp = fopen(argv[1], "rt");
-	if (fp == NULL)
+	if (iter->end != NULL &&
+		(iter->prefixLength > 0 ? strncmp(key, iter->end, iter->prefixLength) != 0
+								: strcmp(key, iter->end) >= 0))
 	{
-		fprintf(stderr, "Cannot open file! [%s]\n", argv[1]);
-		return 200;
+		iter->top = 0;
+		return NULL;
 	}
 
-	while (fscanf(fp, "%s", str) != EOF)
-	{
+	// the leftmost path of the right subtree is no longer than the path popped
+	for (NODE *root = node->right; root != NULL; root = root->left)
+		iter->stack[(iter->top)++] = root;
 
-#if SHOW_STEP
-		fprintf(stdout, "Insert %s>\n", str);
-#endif
-		// insert function call
-		AVL_Insert(tree, str);
+	return key;
+}
 
-#if SHOW_STEP
-		fprintf(stdout, "Tree representation:\n");
-		printTree(tree);
-#endif
-	}
+/* Recycles memory of the scan
+*/
+void AVL_IterEnd(AVL_ITER *iter)
+{
+	free(iter->stack);
+	iter->stack = NULL;
+	iter->top = 0;
+}
 
-	fclose(fp);
+// a key looked up by AVL_RetrieveBatch
+typedef struct
+{
+	char *key;
+	unsigned long long prefix;
+	char **result; // where the found key is stored
+} PROBE;
 
-#if SHOW_STEP
-	fprintf(stdout, "\n");
+static int _compareProbes(const void *a, const void *b)
+{
+	const PROBE *x = a, *y = b;
 
-	// inorder traversal
-	fprintf(stdout, "Inorder traversal: ");
-	AVL_Traverse(tree);
-	fprintf(stdout, "\n");
+	if (x->prefix != y->prefix)
+		return (x->prefix < y->prefix) ? -1 : 1;
 
-	// print tree with right-to-left infix traversal
-	fprintf(stdout, "Tree representation:\n");
-	printTree(tree);
-#endif
-	fprintf(stdout, "Height of tree: %d\n", tree->root->height);
-	fprintf(stdout, "# of nodes: %d\n", tree->count);
+	return strcmp(x->key, y->key);
+}
+
+/* internal function
+	Looks up the sorted probes[0 .. n) in the (sub)tree
+	the probes are split around the key of each node, so every node is visited
+	at most once for the whole batch
+*/
+static void _retrieveBatch(NODE *root, PROBE probes[], int n)
+{
+	if (n == 0)
+		return;
+
+	if (root == NULL)
+	{
+		for (int i = 0; i < n; i++)
+			*probes[i].result = NULL;
+		return;
+	}
+
+	// probes[0 .. first) < key of root <= probes[first .. n)
+	int first = 0, last = n;
+	while (first < last)
+	{
+		int mid = first + (last - first) / 2;
+
+		if (_compare(probes[mid].key, probes[mid].prefix, root) >= 0)
+			last = mid;
+		else
+			first = mid + 1;
+	}
+
+	// probes[first .. last) == key of root
+	last = first;
+	while (last < n && _compare(probes[last].key, probes[last].prefix, root) == 0)
+		*probes[last++].result = _key(root);
+
+	_retrieveBatch(root->left, probes, first);
+	_retrieveBatch(root->right, probes + last, n - last);
+}
+
+/* Retrieve tree for n keys at once
+	the keys are sorted and looked up in one walk of the tree;
+	results[i] receives the address of the key equal to keys[i] or NULL if not found
+	return	1 success
+			0 overflow
+*/
+int AVL_RetrieveBatch(AVL_TREE *pTree, char *keys[], char *results[], int n)
+{
+	if (n <= 0)
+		return 1;
+
+	PROBE *probes = (PROBE *)malloc(n * sizeof(PROBE));
+	if (probes == NULL)
+		return 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		probes[i].key = keys[i];
+		probes[i].prefix = _prefix(keys[i]);
+		probes[i].result = &results[i];
+	}
+
+	qsort(probes, n, sizeof(PROBE), _compareProbes);
+
+	_retrieveBatch(pTree->root, probes, n);
+
+	free(probes);
+
+	return 1;
+}
+
+static void _traverse(NODE *root)
+{
+	if (root == NULL)
+		return;
+
+	_traverse(root->left);
+	printf("%s ", _key(root));
+	_traverse(root->right);
+}
+
+/* Prints tree using inorder traversal
+*/
+void AVL_Traverse(AVL_TREE *pTree)
+{
+	_traverse(pTree->root);
+}
+
+/* internal traversal function
+*/
+static void _infix_print(NODE *root, int level)
+{
+	if (root == NULL)
+		return;
+
+	_infix_print(root->right, level + 1);
+	for (int i = 0; i < level; i++)
+		printf("\t");
+	printf("%s\n", _key(root));
+	_infix_print(root->left, level + 1);
+}
+
+/* Prints tree using inorder right-to-left traversal
+*/
+void printTree(AVL_TREE *pTree)
+{
+	_infix_print(pTree->root, 0);
+}
+
+/* internal function
+	Reads all words of the file
+	n receives the number of words
+	return	array of words (each allocated by strdup)
+			NULL if there are no words or overflow
+*/
+static char **_readWords(FILE *fp, int *n)
+{
+	char str[1024];
+	char **words = NULL;
+	int capacity = 0;
+
+	*n = 0;
+	while (fscanf(fp, "%s", str) != EOF)
+	{
+		if (*n == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 1024;
+			char **temp = (char **)realloc(words, capacity * sizeof(char *));
+			if (temp == NULL)
+				break;
+			words = temp;
+		}
+
+		words[*n] = strdup(str);
+		if (words[*n] == NULL)
+			break;
+		(*n)++;
+	}
+
+	return words;
+}
+
+/* internal function
+	Prints all words beginning with prefix
+*/
+static void _printPrefix(AVL_TREE *pTree, char *prefix)
+{
+	AVL_ITER iter;
+	char *key;
+	int found = 0;
+
+	if (AVL_PrefixBegin(pTree, prefix, &iter))
+	{
+		while ((key = AVL_Next(&iter)) != NULL)
+		{
+			fprintf(stdout, "%s\n", key);
+			found++;
+		}
+	}
+	AVL_IterEnd(&iter);
+
+	fprintf(stdout, "%d words found for %s*\n", found, prefix);
+}
+
+/* internal function
+	Answers all queries of the file at once (main buffers stdout fully for this)
+	exact queries are looked up together by AVL_RetrieveBatch;
+	results are printed in the order of the file
+	return	1 success
+			0 overflow
+*/
+static int _batchQuery(AVL_TREE *pTree, FILE *fp)
+{
+	int n;
+	char **queries = _readWords(fp, &n);
+	char **results = (char **)malloc((n + 1) * sizeof(char *));
+	int ret = (results != NULL) && AVL_RetrieveBatch(pTree, queries, results, n);
+
+	if (ret)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			int length = strlen(queries[i]);
+
+			if (length > 0 && queries[i][length - 1] == '*')
+			{
+				queries[i][length - 1] = '\0';
+				_printPrefix(pTree, queries[i]);
+			}
+
+			else if (results[i])
+				fprintf(stdout, "%s found!\n", results[i]);
+			else
+				fprintf(stdout, "%s NOT found!\n", queries[i]);
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+		free(queries[i]);
+	free(queries);
+	free(results);
+
+	return ret;
+}
+
+#if CONCURRENT
+////////////////////////////////////////////////////////////////////////////////
+// CAVL_TREE: AVL tree for many readers and occasional writers
+// writers copy the nodes on the insert path and swap the root atomically,
+// so readers never lock and always see a complete tree;
+// replaced nodes are recycled once no reader that could see them is left (epochs)
+#define MAX_READERS 64 // live threads with a lock-free reader slot
+
+typedef struct
+{
+	_Alignas(CACHE_LINE) atomic_ulong epoch; // epoch the reader started in, 0 if not reading
+} READER_SLOT;
+
+typedef struct
+{
+	NODE *node;
+	unsigned long epoch; // epoch in which the node was replaced
+} RETIRED;
+
+typedef struct
+{
+	_Atomic(NODE *) root;
+	atomic_ulong epoch;
+	READER_SLOT slots[MAX_READERS];
+
+	// used only by the writer holding writeLock
+	pthread_mutex_t writeLock;
+	AVL_TREE *tree; // node pool and count; its root follows the published root
+	RETIRED *retired;
+	int nRetired;
+	int capacity;
+} CAVL_TREE;
+
+static atomic_bool slotTaken[MAX_READERS];
+static pthread_key_t slotKey; // value is the slot of the thread + 1
+static pthread_once_t slotKeyOnce = PTHREAD_ONCE_INIT;
+
+/* internal function
+	Gives the reader slot of an exiting thread back
+*/
+static void _releaseSlot(void *value)
+{
+	atomic_store(&slotTaken[(intptr_t)value - 1], 0);
+}
+
+static void _makeSlotKey(void)
+{
+	pthread_key_create(&slotKey, _releaseSlot);
+}
+
+/* Reader slot of the calling thread
+	a slot is kept until its thread exits;
+	a thread that found all slots taken tries again on its next call
+	return	index of the slot
+			-1 if all slots are taken
+*/
+static int _readerSlot(void)
+{
+	static _Thread_local int slot = -1;
+
+	if (slot < 0)
+	{
+		pthread_once(&slotKeyOnce, _makeSlotKey);
+
+		for (int i = 0; i < MAX_READERS; i++)
+			if (!atomic_load(&slotTaken[i]) && !atomic_exchange(&slotTaken[i], 1))
+			{
+				slot = i;
+				pthread_setspecific(slotKey, (void *)(intptr_t)(i + 1));
+				break;
+			}
+	}
+
+	return slot;
+}
+
+/* Allocates dynamic memory for a concurrent AVL tree head node
+	return	head node pointer
+			NULL if overflow
+*/
+CAVL_TREE *CAVL_Create(void)
+{
+	CAVL_TREE *temp = aligned_alloc(CACHE_LINE, sizeof(CAVL_TREE));
+	if (temp == NULL)
+		return NULL;
+
+	temp->tree = AVL_Create();
+	if (temp->tree == NULL)
+	{
+		free(temp);
+		return NULL;
+	}
+
+	atomic_init(&temp->root, NULL);
+	atomic_init(&temp->epoch, 1);
+	for (int i = 0; i < MAX_READERS; i++)
+		atomic_init(&temp->slots[i].epoch, 0);
+
+	pthread_mutex_init(&temp->writeLock, NULL);
+	temp->retired = NULL;
+	temp->nRetired = 0;
+	temp->capacity = 0;
+
+	return temp;
+}
+
+/* Deletes all data in tree and recycles memory
+	no thread may use the tree any more
+*/
+void CAVL_Destroy(CAVL_TREE *cTree)
+{
+	// retired nodes share keys with live nodes and live in the chunks of the pool
+	AVL_Destroy(cTree->tree);
+
+	pthread_mutex_destroy(&cTree->writeLock);
+	free(cTree->retired);
+	free(cTree);
+}
+
+/* internal function
+	Recycles the retired nodes that no reader can reach any more
+	keys are not freed because the copies replacing the nodes still use them
+*/
+static void _reclaim(CAVL_TREE *cTree)
+{
+	unsigned long oldest = atomic_load(&cTree->epoch);
+
+	for (int i = 0; i < MAX_READERS; i++)
+	{
+		unsigned long epoch = atomic_load(&cTree->slots[i].epoch);
+		if (epoch != 0 && epoch < oldest)
+			oldest = epoch;
+	}
+
+	int kept = 0;
+	for (int i = 0; i < cTree->nRetired; i++)
+	{
+		NODE *node = cTree->retired[i].node;
+
+		if (cTree->retired[i].epoch < oldest)
+		{
+			node->left = cTree->tree->freeNodes;
+			cTree->tree->freeNodes = node;
+		}
+		else
+			cTree->retired[kept++] = cTree->retired[i];
+	}
+
+	cTree->nRetired = kept;
+}
+
+/* internal function
+	Inserts data below root without changing any node a reader can see
+	every node on the path is replaced by a copy and retired;
+	rotations after an insert only touch nodes on the path, so they work on copies
+	result is 1 if a node is added, 2 if the counter of an existing node is increased, 0 if overflow
+	return	pointer to new root
+*/
+static NODE *_copyInsert(CAVL_TREE *cTree, NODE *root, char *data, unsigned long long prefix, unsigned long epoch, int *result)
+{
+	if (root == NULL)
+	{
+		NODE *newNode = _makeNode(cTree->tree, data);
+		*result = (newNode != NULL);
+		return newNode;
+	}
+
+	NODE *copy = _allocNode(cTree->tree);
+	if (copy == NULL)
+	{
+		*result = 0;
+		return root;
+	}
+
+	*copy = *root;
+
+	int res = _compare(data, prefix, root);
+
+#if UPSERT
+	if (res == 0)
+	{
+		(copy->count)++;
+		*result = 2;
+	}
+	else if (res < 0)
+#else
+	if (res < 0)
+#endif
+		copy->left = _copyInsert(cTree, root->left, data, prefix, epoch, result);
+
+	else
+		copy->right = _copyInsert(cTree, root->right, data, prefix, epoch, result);
+
+	if (*result == 0)
+	{
+		copy->left = cTree->tree->freeNodes;
+		cTree->tree->freeNodes = copy;
+		return root;
+	}
+
+	cTree->retired[cTree->nRetired].node = root;
+	cTree->retired[cTree->nRetired].epoch = epoch;
+	(cTree->nRetired)++;
+
+	return (*result == 1) ? _balance(copy) : copy;
+}
+
+/* Inserts new data into the tree and publishes the new version to readers
+	return	1 success
+			0 overflow
+*/
+int CAVL_Insert(CAVL_TREE *cTree, char *data)
+{
+	int result = 0;
+
+	pthread_mutex_lock(&cTree->writeLock);
+
+	NODE *root = cTree->tree->root;
+	int needed = cTree->nRetired + getHeight(root);
+
+	if (needed > cTree->capacity)
+	{
+		int capacity = max(needed, cTree->capacity * 2);
+		RETIRED *temp = realloc(cTree->retired, capacity * sizeof(RETIRED));
+
+		if (temp == NULL)
+		{
+			pthread_mutex_unlock(&cTree->writeLock);
+			return 0;
+		}
+
+		cTree->retired = temp;
+		cTree->capacity = capacity;
+	}
+
+	unsigned long epoch = atomic_load(&cTree->epoch);
+
+	root = _copyInsert(cTree, root, data, _prefix(data), epoch, &result);
+
+	if (result != 0)
+	{
+		cTree->tree->root = root;
+		atomic_store(&cTree->root, root);
+
+		// readers starting from now on see only the new root
+		atomic_store(&cTree->epoch, epoch + 1);
+
+		if (result == 1)
+			(cTree->tree->count)++;
+
+		_reclaim(cTree);
+	}
+
+	pthread_mutex_unlock(&cTree->writeLock);
+
+	return result != 0;
+}
+
+/* Retrieve tree for the requested key without locking
+	(a thread without a reader slot takes the write lock instead)
+	nodes may be recycled after the call, so only the result is returned
+	return	1 found
+			0 not found
+*/
+int CAVL_Retrieve(CAVL_TREE *cTree, char *key)
+{
+	int slot = _readerSlot();
+	int found;
+
+	if (slot < 0)
+	{
+		pthread_mutex_lock(&cTree->writeLock);
+		found = (_retrieve(cTree->tree->root, key, _prefix(key)) != NULL);
+		pthread_mutex_unlock(&cTree->writeLock);
+
+		return found;
+	}
+
+	READER_SLOT *reader = &cTree->slots[slot];
+
+	atomic_store(&reader->epoch, atomic_load(&cTree->epoch));
+
+	found = (_retrieve(atomic_load(&cTree->root), key, _prefix(key)) != NULL);
+
+	atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+
+	return found;
+}
+
+/* Per-thread xorshift random number
+*/
+static unsigned int _random(void)
+{
+	static _Thread_local unsigned int state = 0;
+
+	if (state == 0)
+		state = (unsigned int)(uintptr_t)&state | 1; // differs per thread
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return state;
+}
+
+// plain tree behind one global lock, the baseline for the benchmark
+typedef struct
+{
+	pthread_mutex_t lock;
+	AVL_TREE *tree;
+} LOCKED_TREE;
+
+static int _lockedInsert(void *dict, char *data)
+{
+	LOCKED_TREE *locked = dict;
+
+	pthread_mutex_lock(&locked->lock);
+	int ret = AVL_Insert(locked->tree, data);
+	pthread_mutex_unlock(&locked->lock);
+
+	return ret;
+}
+
+static int _lockedRetrieve(void *dict, char *key)
+{
+	LOCKED_TREE *locked = dict;
+
+	pthread_mutex_lock(&locked->lock);
+	int found = (AVL_Retrieve(locked->tree, key) != NULL);
+	pthread_mutex_unlock(&locked->lock);
+
+	return found;
+}
+
+static int _cavlInsert(void *dict, char *data)
+{
+	return CAVL_Insert(dict, data);
+}
+
+static int _cavlRetrieve(void *dict, char *key)
+{
+	return CAVL_Retrieve(dict, key);
+}
+
+#define INSERT_RATE 1000 // one insert every INSERT_RATE operations
+
+typedef struct
+{
+	void *dict;
+	int (*insert)(void *, char *);
+	int (*retrieve)(void *, char *);
+	char **words;
+	int nWords;
+	int ops;
+	atomic_int nextId; // makes inserted words unique
+	atomic_long found;
+} WORKER;
+
+/* Benchmark thread: lookups of random dictionary words with occasional inserts
+*/
+static void *_worker(void *arg)
+{
+	WORKER *worker = arg;
+	char str[1024];
+	long found = 0;
+
+	for (int i = 0; i < worker->ops; i++)
+	{
+		char *word = worker->words[_random() % worker->nWords];
+
+		if (i % INSERT_RATE == INSERT_RATE - 1)
+		{
+			snprintf(str, sizeof(str), "%s#%d", word, atomic_fetch_add(&worker->nextId, 1));
+			worker->insert(worker->dict, str);
+		}
+		else
+			found += worker->retrieve(worker->dict, word);
+	}
+
+	atomic_fetch_add(&worker->found, found);
+
+	return NULL;
+}
+
+/* Runs nThreads workers sharing totalOps operations on dict
+	return	throughput in million operations per second
+			-1 if a thread could not be started (the started ones are joined)
+*/
+static double _runWorkers(void *dict, int (*insert)(void *, char *), int (*retrieve)(void *, char *),
+						  char **words, int nWords, int nThreads, int totalOps)
+{
+	pthread_t threads[nThreads];
+	WORKER worker = {.dict = dict, .insert = insert, .retrieve = retrieve, .words = words, .nWords = nWords, .ops = totalOps / nThreads};
+	struct timespec start, end;
+
+	atomic_init(&worker.nextId, 0);
+	atomic_init(&worker.found, 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	int started = 0;
+	while (started < nThreads && pthread_create(&threads[started], NULL, _worker, &worker) == 0)
+		started++;
+	for (int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (started < nThreads)
+		return -1;
+
+	// every dictionary word is present
+	if (atomic_load(&worker.found) != (long)worker.ops * nThreads - (worker.ops / INSERT_RATE) * nThreads)
+		fprintf(stderr, "Lookup failed!\n");
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	return (double)worker.ops * nThreads / seconds / 1e6;
+}
+
+/* Compares the copy-on-write tree with one globally locked tree for 1 ~ 32 threads
+	both trees are loaded with the words of the file
+*/
+static void _scalingBenchmark(FILE *fp)
+{
+	const int totalOps = 1 << 22;
+	int nWords;
+	char **words = _readWords(fp, &nWords);
+
+	for (int nThreads = 1; nThreads <= 32 && nWords > 0; nThreads *= 2)
+	{
+		LOCKED_TREE locked;
+		pthread_mutex_init(&locked.lock, NULL);
+		locked.tree = AVL_Create();
+
+		CAVL_TREE *cTree = CAVL_Create();
+
+		int ok = (locked.tree != NULL && cTree != NULL);
+		if (!ok)
+			fprintf(stderr, "Cannot create tree!\n");
+
+		for (int i = 0; i < nWords && ok; i++)
+		{
+			AVL_Insert(locked.tree, words[i]);
+			CAVL_Insert(cTree, words[i]);
+		}
+
+		if (ok)
+		{
+			double lockedRate = _runWorkers(&locked, _lockedInsert, _lockedRetrieve, words, nWords, nThreads, totalOps);
+			double cowRate = (lockedRate < 0) ? -1 : _runWorkers(cTree, _cavlInsert, _cavlRetrieve, words, nWords, nThreads, totalOps);
+
+			ok = (cowRate >= 0);
+			if (ok)
+				printf("threads %2d  global lock %8.2f Mops/s  copy-on-write %8.2f Mops/s\n", nThreads, lockedRate, cowRate);
+			else
+				fprintf(stderr, "Cannot start %d threads!\n", nThreads);
+		}
+
+		if (locked.tree != NULL)
+			AVL_Destroy(locked.tree);
+		pthread_mutex_destroy(&locked.lock);
+		if (cTree != NULL)
+			CAVL_Destroy(cTree);
+
+		if (!ok)
+			break;
+	}
+
+	for (int i = 0; i < nWords; i++)
+		free(words[i]);
+	free(words);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	AVL_TREE *tree;
+	char str[1024];
+
+	if (argc != 2 && argc != 3)
+	{
+		fprintf(stderr, "Usage: %s FILE [QUERY_FILE]\n", argv[0]);
+		return 0;
+	}
+
+	// batch results are written in large blocks; setvbuf must come before any output
+	if (argc == 3)
+		setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	// creates a null tree
+	tree = AVL_Create();
+
+	if (!tree)
+	{
+		fprintf(stderr, "Cannot create tree!\n");
+		return 100;
+	}
+
+	FILE *fp = fopen(argv[1], "rt");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Cannot open file! [%s]\n", argv[1]);
+		return 200;
+	}
+
+#if CONCURRENT
+	_scalingBenchmark(fp);
+
+	fclose(fp);
+	AVL_Destroy(tree);
+
+	return 0;
+#endif
+
+#if BULK_LOAD
+	int nWords;
+	char **words = _readWords(fp, &nWords);
+#else
+	while (fscanf(fp, "%s", str) != EOF)
+	{
+#if SHOW_STEP
+		fprintf(stdout, "Insert %s>\n", str);
+#endif
+		// insert function call
+		AVL_Insert(tree, str);
+
+#if SHOW_STEP
+		fprintf(stdout, "Tree representation:\n");
+		printTree(tree);
+#endif
+	}
+#endif
+
+	fclose(fp);
+
+#if BULK_LOAD
+	AVL_Destroy(tree);
+	tree = AVL_BuildFrom(words, nWords);
+
+	for (int i = 0; i < nWords; i++)
+		free(words[i]);
+	free(words);
+
+	if (!tree)
+	{
+		fprintf(stderr, "Cannot create tree!\n");
+		return 100;
+	}
+#endif
+
+#if SHOW_STEP
+	fprintf(stdout, "\n");
+
+	// inorder traversal
+	fprintf(stdout, "Inorder traversal: ");
+	AVL_Traverse(tree);
+	fprintf(stdout, "\n");
+
+	// print tree with right-to-left infix traversal
+	fprintf(stdout, "Tree representation:\n");
+	printTree(tree);
+#endif
+	fprintf(stdout, "Height of tree: %d\n", tree->root->height);
+	fprintf(stdout, "# of nodes: %d\n", tree->count);
+
+	// batch retrieval
+	if (argc == 3)
+	{
+		FILE *queryFp = fopen(argv[2], "rt");
+		if (queryFp == NULL)
+		{
+			fprintf(stderr, "Cannot open file! [%s]\n", argv[2]);
+			AVL_Destroy(tree);
+			return 200;
+		}
+
+		int ret = _batchQuery(tree, queryFp);
+		fclose(queryFp);
+		AVL_Destroy(tree);
+
+		if (!ret)
+		{
+			fprintf(stderr, "Cannot answer queries!\n");
+			return 100;
+		}
+
+		return 0;
+	}
 
 	// retrieval
 	char *key;
 	fprintf(stdout, "Query: ");
 	while (fscanf(stdin, "%s", str) != EOF)
 	{
+		int length = strlen(str);
+
+		// "abc*" lists all words beginning with "abc"
+		if (length > 0 && str[length - 1] == '*')
+		{
+			str[length - 1] = '\0';
+			_printPrefix(tree, str);
+			fprintf(stdout, "Query: ");
+			continue;
+		}
+
 		key = AVL_Retrieve(tree, str);
 
 		if (key)
@@ -2,6 +2,17 @@
 #include <stdlib.h> // malloc
 #include <string.h> // strdup
 #include <ctype.h>	// isupper, tolower
+#include <time.h>	// clock
+#include <fcntl.h>	  // open
+#include <unistd.h>	  // close
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+
+#define MEMORY_REPORT 0 // print bytes per key of the trie after loading the dictionary
+#define RADIX 0			// path-compressed trie: single-child runs are merged into edge labels
+#define BENCHMARK 0		// time wildcard search and top-K completion instead of queries
+
+#define MAX_WORD 1024 // longer words are skipped when reading
 
 #define MAX_DEGREE 27 // 'a' ~ 'z' and EOW
 #define EOW '$'		  // end of word
@@ -10,29 +21,258 @@
 #define getIndex(x) (((x) == EOW) ? MAX_DEGREE - 1 : ((x) - 'a'))
 
 // TRIE type definition
+// only existing subtrees are stored: bit i of bitmap tells if subtree i exists
+// and subtrees[] holds them in order of i
+// in RADIX mode a node also holds the label of the edge from its parent,
+// and subtree i is the one whose label starts with character i
 typedef struct trieNode
 {
-	int index; // -1 (non-word), 0, 1, 2, ...
-	struct trieNode *subtrees[MAX_DEGREE];
+	int index;			 // -1 (non-word), 0, 1, 2, ...
+	unsigned int bitmap; // MAX_DEGREE bits
+	struct trieNode **subtrees;
+#if RADIX
+	int length;	  // length of label
+	char label[]; // not null-terminated
+#endif
 } TRIE;
 
+/* returns address of the slot of subtree i in root->subtrees
+*/
+static inline TRIE **_slot(TRIE *root, int i)
+{
+	return &root->subtrees[__builtin_popcount(root->bitmap & ((1u << i) - 1))];
+}
+
+/* returns subtree i of root or NULL
+*/
+static inline TRIE *_child(TRIE *root, int i)
+{
+	if (!(root->bitmap & (1u << i)))
+		return NULL;
+
+	return *_slot(root, i);
+}
+
+/* number of subtrees of root
+*/
+static inline int _degree(TRIE *root)
+{
+	return __builtin_popcount(root->bitmap);
+}
+
+// DICT type definition
+// all words are kept one after another (null-terminated) in blob;
+// word i starts at blob + offsets[i]
+typedef struct
+{
+	char *blob;
+	int *offsets;
+	int *scores;  // score of each word (NULL in a mapped dictionary)
+	int n;		  // number of words
+	int blobSize; // bytes used in blob
+	int blobCapacity;
+	int capacity; // of offsets
+} DICT;
+
+/* returns word i of dic
+*/
+static inline char *dictWord(DICT *dic, int i)
+{
+	return dic->blob + dic->offsets[i];
+}
+
+// TRIE_SCORES type definition
+// best entries of the subtrees of a trie, kept apart so that nodes stay small;
+// arrays are indexed by the position of the node in preorder (the root is 0)
+typedef struct
+{
+	int *best;	// index of the best entry in the subtree (smallest one on ties), -1 if none
+	int *nodes; // number of nodes in the subtree, so subtree j + 1 follows subtree j
+	int n;		// number of nodes
+} TRIE_SCORES;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Prototype declarations
 
+#if RADIX
+/* Allocates a node whose edge is labeled with label[0 .. length)
+return	node pointer
+NULL if overflow
+*/
+static TRIE *_makeNode(const char *label, int length)
+{
+	TRIE *temp = (TRIE *)malloc(sizeof(TRIE) + length);
+	if (temp == NULL)
+		return NULL;
+
+	temp->index = -1;
+	temp->bitmap = 0;
+	temp->subtrees = NULL;
+	temp->length = length;
+	memcpy(temp->label, label, length);
+
+	return temp;
+}
+#endif
+
+/* Allocates dynamic memory for a dictionary with room for about bytes of words
+return	dictionary pointer
+NULL if overflow
+*/
+DICT *dictCreate(int bytes)
+{
+	DICT *temp = (DICT *)malloc(sizeof(DICT));
+	if (temp == NULL)
+		return NULL;
+
+	temp->blobCapacity = (bytes > 1024) ? bytes : 1024;
+	temp->capacity = temp->blobCapacity / 8; // a word and its newline take about 8 bytes
+	temp->blob = (char *)malloc(temp->blobCapacity);
+	temp->offsets = (int *)malloc(temp->capacity * sizeof(int));
+	temp->scores = (int *)malloc(temp->capacity * sizeof(int));
+	temp->n = temp->blobSize = 0;
+
+	if (temp->blob == NULL || temp->offsets == NULL || temp->scores == NULL)
+	{
+		free(temp->blob);
+		free(temp->offsets);
+		free(temp->scores);
+		free(temp);
+		return NULL;
+	}
+
+	return temp;
+}
+
+/* Recycles memory of the dictionary
+*/
+void dictDestroy(DICT *dic)
+{
+	if (dic == NULL)
+		return;
+
+	free(dic->blob);
+	free(dic->offsets);
+	free(dic->scores);
+	free(dic);
+}
+
+/* Appends str (of length characters) with its score to the dictionary as word dic->n
+return	1 success
+0 overflow
+*/
+int dictAdd(DICT *dic, char *str, int length, int score)
+{
+	if (dic->blobSize + length + 1 > dic->blobCapacity)
+	{
+		int capacity = dic->blobCapacity;
+		while (dic->blobSize + length + 1 > capacity)
+			capacity *= 2;
+
+		char *blob = (char *)realloc(dic->blob, capacity);
+		if (blob == NULL)
+			return 0;
+
+		dic->blob = blob;
+		dic->blobCapacity = capacity;
+	}
+
+	if (dic->n == dic->capacity)
+	{
+		int *offsets = (int *)realloc(dic->offsets, dic->capacity * 2 * sizeof(int));
+		if (offsets == NULL)
+			return 0;
+		dic->offsets = offsets;
+
+		int *scores = (int *)realloc(dic->scores, dic->capacity * 2 * sizeof(int));
+		if (scores == NULL)
+			return 0;
+		dic->scores = scores;
+
+		dic->capacity *= 2;
+	}
+
+	dic->scores[dic->n] = score;
+	dic->offsets[dic->n++] = dic->blobSize;
+	memcpy(dic->blob + dic->blobSize, str, length + 1);
+	dic->blobSize += length + 1;
+
+	return 1;
+}
+
+/* Reads the next word (separated by white space) of fp into str of size bytes
+words that do not fit are skipped; the white space after the word is left in fp
+return	length of the word
+-1 if end of file
+*/
+static int _readWord(FILE *fp, char *str, int size)
+{
+	int c;
+
+	for (;;)
+	{
+		while ((c = getc(fp)) != EOF && isspace(c))
+			;
+
+		if (c == EOF)
+			return -1;
+
+		int length = 0;
+		for (; c != EOF && !isspace(c); c = getc(fp))
+		{
+			if (length < size - 1)
+				str[length] = c;
+			length++;
+		}
+
+		if (c != EOF)
+			ungetc(c, fp);
+
+		if (length < size)
+		{
+			str[length] = '\0';
+			return length;
+		}
+	}
+}
+
+/* Reads the score written after a word on the same line ("word 123")
+return	the score
+0 if the line has none
+*/
+static int _readScore(FILE *fp)
+{
+	int c, score;
+
+	while ((c = getc(fp)) == ' ' || c == '\t')
+		;
+	ungetc(c, fp);
+
+	if (isdigit(c) && fscanf(fp, "%d", &score) == 1)
+		return score;
+
+	return 0;
+}
+
 /* Allocates dynamic memory for a trie node and returns its address to caller
 return	node pointer
 NULL if overflow
 */
 TRIE *trieCreateNode(void)
 {
+#if RADIX
+	return _makeNode("", 0);
+#else
 	TRIE *temp = (TRIE *)malloc(sizeof(TRIE));
 	if (temp == NULL)
 		return NULL;
 
 	temp->index = -1;
-	memset(temp->subtrees, 0, sizeof(temp->subtrees));
+	temp->bitmap = 0;
+	temp->subtrees = NULL;
 
 	return temp;
+#endif
 }
 
 /* Deletes all data in trie and recycles memory
@@ -42,12 +282,123 @@ void trieDestroy(TRIE *root)
 	if (root == NULL)
 		return;
 
-	for (int i = 0; i < MAX_DEGREE; i++)
+	for (int i = 0; i < _degree(root); i++)
 		trieDestroy(root->subtrees[i]);
 
+	free(root->subtrees);
 	free(root);
 }
 
+/* Counts nodes of trie and bytes allocated for them (without malloc overhead)
+*/
+void trieMemory(TRIE *root, long *nodes, long *bytes)
+{
+	if (root == NULL)
+		return;
+
+	(*nodes)++;
+	*bytes += sizeof(TRIE) + _degree(root) * sizeof(TRIE *);
+#if RADIX
+	*bytes += root->length;
+#endif
+
+	for (int i = 0; i < _degree(root); i++)
+		trieMemory(root->subtrees[i], nodes, bytes);
+}
+
+/* Adds subtree as subtree i of root (which has no subtree i yet)
+return	1 success
+0 overflow
+*/
+static int _addChild(TRIE *root, int i, TRIE *subtree)
+{
+	int degree = _degree(root);
+
+	TRIE **subtrees = (TRIE **)realloc(root->subtrees, (degree + 1) * sizeof(TRIE *));
+	if (subtrees == NULL)
+		return 0;
+	root->subtrees = subtrees;
+
+	TRIE **slot = _slot(root, i);
+	memmove(slot + 1, slot, (degree - (slot - subtrees)) * sizeof(TRIE *));
+	*slot = subtree;
+	root->bitmap |= 1u << i;
+
+	return 1;
+}
+
+#if RADIX
+/* Inserts the rest of an entry (str) below root
+a new word hangs below root as one leaf whose label is all of str;
+an edge whose label only partly matches str is split in two
+return	1 success
+0 failure
+*/
+static int _insert(TRIE *root, char *str, int dic_index)
+{
+	if (*str == '\0')
+	{
+		if (root->index == -1)
+		{
+			root->index = dic_index;
+			return 1;
+		}
+
+		else
+			return 0;
+	}
+
+	int index = getIndex(*str);
+	TRIE *subtree = _child(root, index);
+
+	if (subtree == NULL)
+	{
+		subtree = _makeNode(str, strlen(str));
+		if (subtree == NULL)
+			return 0;
+
+		if (!_addChild(root, index, subtree))
+		{
+			free(subtree);
+			return 0;
+		}
+
+		subtree->index = dic_index;
+		return 1;
+	}
+
+	int k = 0;
+	while (k < subtree->length && subtree->label[k] == str[k])
+		k++;
+
+	if (k < subtree->length)
+	{
+		// split: the new node takes label[0 .. k) and subtree keeps label[k ..]
+		TRIE *split = _makeNode(subtree->label, k);
+		TRIE **subtrees = (TRIE **)malloc(sizeof(TRIE *));
+
+		if (split == NULL || subtrees == NULL)
+		{
+			free(split);
+			free(subtrees);
+			return 0;
+		}
+
+		subtree->length -= k;
+		memmove(subtree->label, subtree->label + k, subtree->length);
+
+		split->subtrees = subtrees;
+		split->subtrees[0] = subtree;
+		split->bitmap = 1u << getIndex(subtree->label[0]);
+
+		*_slot(root, index) = split;
+		subtree = split;
+	}
+
+	return _insert(subtree, str + k, dic_index);
+}
+#endif
+
 /* Inserts new entry into the trie
 return	1 success
 0 failure
@@ -57,6 +408,14 @@ return	1 success
 // 영문자와 EOW 외 문자를 포함하는 문자열은 삽입하지 않음
 int trieInsert(TRIE *root, char *str, int dic_index)
 {
+#if RADIX
+	// checked before anything is split
+	for (char *p = str; *p != '\0'; p++)
+		if (getIndex(*p) < 0 || getIndex(*p) > MAX_DEGREE - 1)
+			return 0;
+
+	return _insert(root, str, dic_index);
+#else
 	if (*str == '\0')
 	{
 		if (root->index == -1)
@@ -73,15 +432,52 @@ int trieInsert(TRIE *root, char *str, int dic_index)
 	if (index < 0 || index > MAX_DEGREE - 1)
 		return 0;
 
-	if (root->subtrees[index] == NULL)
+	TRIE *subtree = _child(root, index);
+
+	if (subtree == NULL)
 	{
-		root->subtrees[index] = trieCreateNode();
+		subtree = trieCreateNode();
+		if (subtree == NULL)
+			return 0;
 
-		if (root->subtrees[index] == NULL)
+		if (!_addChild(root, index, subtree))
+		{
+			free(subtree);
 			return 0;
+		}
 	}
 
-	return trieInsert(root->subtrees[index], str + 1, dic_index);
+	return trieInsert(subtree, str + 1, dic_index);
+#endif
+}
+
+/* Follows the edge from root that matches the beginning of str
+length receives the number of characters of the edge (0 if none)
+return	subtree at the end of the edge
+NULL if no edge matches
+*/
+static TRIE *_step(TRIE *root, char *str, int *length)
+{
+	*length = 0;
+
+	int index = getIndex(*str);
+	if (index < 0 || index > MAX_DEGREE - 1)
+		return NULL;
+
+	TRIE *subtree = _child(root, index);
+	if (subtree == NULL)
+		return NULL;
+
+#if RADIX
+	if (strncmp(subtree->label, str, subtree->length) != 0)
+		return NULL;
+
+	*length = subtree->length;
+#else
+	*length = 1;
+#endif
+
+	return subtree;
 }
 
 /* Retrieve trie for the requested key
@@ -96,124 +492,1592 @@ int trieSearch(TRIE *root, char *str)
 	if (*str == '\0')
 		return root->index;
 
-	int index = getIndex(*str);
-	if (index < 0 || index > MAX_DEGREE - 1)
-		return -1;
+	int length;
+	TRIE *subtree = _step(root, str, &length);
 
-	return trieSearch(root->subtrees[index], str + 1);
+	return trieSearch(subtree, str + length);
 }
 
 /* prints all entries in trie using preorder traversal
 */
-void trieList(TRIE *root, char *dic[]) {
+void trieList(TRIE *root, DICT *dic) {
 	if (root == NULL)
 		return;
 	
 	if (root->index != -1)
-		printf("%s\n", dic[root->index]);
+		printf("%s\n", dictWord(dic, root->index));
 
-	for (int i = 0; i < MAX_DEGREE; i++)
+	// subtrees are kept in order of index
+	for (int i = 0; i < _degree(root); i++)
 		trieList(root->subtrees[i], dic);
 }
 
-/* prints all entries starting with str (as prefix) in trie
-ex) "abb" -> "abbess", "abbesses", "abbey", ...
-using trieList function
+/* returns subtree i of root or NULL like _child
+if scores is not NULL, pos (the preorder position of root) becomes that of the subtree
 */
-void triePrefixList(TRIE *root, char *str, char *dic[]) {
-	if (root == NULL)
-		return;
+static TRIE *_childAt(TRIE *root, int i, TRIE_SCORES *scores, int *pos)
+{
+	TRIE *subtree = _child(root, i);
 
-	if (*str == '\0') {
-		trieList(root, dic);
-		return;
+	if (subtree != NULL && scores != NULL)
+	{
+		int p = *pos + 1;
+		for (int j = 0; root->subtrees[j] != subtree; j++)
+			p += scores->nodes[p];
+		*pos = p;
 	}
 
+	return subtree;
+}
+
+/* returns the node whose subtree holds all entries starting with str
+NULL if there is none
+if scores is not NULL, pos (0 for the root) receives the preorder position of the node
+*/
+static TRIE *_prefixNodeAt(TRIE *root, char *str, TRIE_SCORES *scores, int *pos)
+{
+	if (root == NULL || *str == '\0')
+		return root;
+
 	int index = getIndex(*str);
-	if (index < 0 || index > MAX_DEGREE)
-		return;
+	if (index < 0 || index > MAX_DEGREE - 1)
+		return NULL;
+
+#if RADIX
+	TRIE *subtree = _childAt(root, index, scores, pos);
+	if (subtree == NULL)
+		return NULL;
+
+	int k = 0;
+	while (k < subtree->length && subtree->label[k] == str[k])
+		k++;
+
+	// str may end inside the label
+	if (str[k] == '\0')
+		return subtree;
+
+	if (k < subtree->length)
+		return NULL;
 
-	triePrefixList(root->subtrees[index], str + 1, dic);
+	return _prefixNodeAt(subtree, str + k, scores, pos);
+#else
+	return _prefixNodeAt(_childAt(root, index, scores, pos), str + 1, scores, pos);
+#endif
 }
 
-// 아래는 구현하지 않아도 됨
-/* makes permuterms for given str
-ex) "abc" -> "abc$", "bc$a", "c$ab", "$abc"
-return	number of permuterms
+/* returns the node whose subtree holds all entries starting with str
+NULL if there is none
 */
-int make_permuterms(char *str, char *permuterms[]);
+static TRIE *_prefixNode(TRIE *root, char *str)
+{
+	return _prefixNodeAt(root, str, NULL, NULL);
+}
 
-/* recycles memory for permuterms
+/* prints all entries starting with str (as prefix) in trie
+ex) "abb" -> "abbess", "abbesses", "abbey", ...
+using trieList function
 */
-void clear_permuterms(char *permuterms[], int size);
+void triePrefixList(TRIE *root, char *str, DICT *dic) {
+	trieList(_prefixNode(root, str), dic);
+}
 
-/* wildcard search
-ex) "ab*", "*ab", "a*b", "*ab*"
-using triePrefixList function
+/* returns 1 if entry a (score, index) ranks before entry b
+higher scores first, smaller indices first on ties
 */
-void trieSearchWildcard(TRIE *root, char *str, char *dic[]);
+static inline int _better(int scoreA, int a, int scoreB, int b)
+{
+	return scoreA > scoreB || (scoreA == scoreB && a < b);
+}
 
-////////////////////////////////////////////////////////////////////////////////
-int main(int argc, char **argv)
+/* fills the scores of the subtree of root, which is at position pos
+return	position following the subtree
+*/
+static int _fillScores(TRIE *root, TRIE_SCORES *scores, DICT *dic, int pos)
 {
-	TRIE *trie;
-	int ret;
-	char str[100];
-	FILE *fp;
-	char *dic[100000];
+	int best = root->index;
+	int p = pos + 1;
 
-	if (argc != 2)
+	for (int i = 0; i < _degree(root); i++)
 	{
-		fprintf(stderr, "Usage: %s FILE\n", argv[0]);
-		return 1;
-	}
+		int child = p;
+		p = _fillScores(root->subtrees[i], scores, dic, p);
 
-	fp = fopen(argv[1], "rt");
-	if (fp == NULL)
-	{
-		fprintf(stderr, "File open error: %s\n", argv[1]);
-		return 1;
+		int b = scores->best[child];
+		if (b != -1 && (best == -1 || _better(dic->scores[b], b, dic->scores[best], best)))
+			best = b;
 	}
 
-	trie = trieCreateNode();
+	scores->best[pos] = best;
+	scores->nodes[pos] = p - pos;
 
-	int index = 0;
-	while (fscanf(fp, "%s", str) != EOF)
-	{
-		ret = trieInsert(trie, str, index);
+	return p;
+}
 
-		if (ret)
-			dic[index++] = strdup(str);
-	}
+/* Allocates the best entries of every subtree of trie from the scores of the dictionary
+to be called after all entries are inserted
+return	scores pointer
+NULL if overflow
+*/
+TRIE_SCORES *trieScoresCreate(TRIE *root, DICT *dic)
+{
+	long nodes = 0, bytes = 0;
+	trieMemory(root, &nodes, &bytes);
 
-	fclose(fp);
+	TRIE_SCORES *temp = (TRIE_SCORES *)malloc(sizeof(TRIE_SCORES));
+	if (temp == NULL)
+		return NULL;
 
-	fprintf(stdout, "\nQuery: ");
-	while (fscanf(stdin, "%s", str) != EOF)
-	{
-		// wildcard search
-		if (str[strlen(str) - 1] == '*')
-		{
-			str[strlen(str) - 1] = 0;
-			triePrefixList( trie, str, dic);
-		}
-		// keyword search
-		else
-		{
-			ret = trieSearch(trie, str);
-			if (ret == -1)
-				printf("[%s] not found!\n", str);
-			else
-				printf("[%s] found!\n", dic[ret]);
-		}
+	temp->n = nodes;
+	temp->best = (int *)malloc(nodes * sizeof(int));
+	temp->nodes = (int *)malloc(nodes * sizeof(int));
 
-		fprintf(stdout, "\nQuery: ");
+	if (temp->best == NULL || temp->nodes == NULL)
+	{
+		free(temp->best);
+		free(temp->nodes);
+		free(temp);
+		return NULL;
 	}
 
-	for (int i = 0; i < index; i++)
-		free(dic[i]);
+	_fillScores(root, temp, dic, 0);
+
+	return temp;
+}
+
+/* Recycles memory of the scores
+*/
+void trieScoresDestroy(TRIE_SCORES *scores)
+{
+	if (scores == NULL)
+		return;
+
+	free(scores->best);
+	free(scores->nodes);
+	free(scores);
+}
+
+// an entry or a subtree waiting in the heap of trieTopK
+// a subtree ranks as its best entry, so no entry of it can come before it
+typedef struct
+{
+	int score;
+	int index;
+	TRIE *node; // NULL for the entry index itself
+	int pos;	// preorder position of node
+} CANDIDATE;
+
+/* Adds a candidate to the max-heap of size elements (room was made by caller)
+*/
+static void _pushCandidate(CANDIDATE heap[], int size, int score, int index, TRIE *node, int pos)
+{
+	int i = size;
+
+	while (i > 0 && _better(score, index, heap[(i - 1) / 2].score, heap[(i - 1) / 2].index))
+	{
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+
+	heap[i].score = score;
+	heap[i].index = index;
+	heap[i].node = node;
+	heap[i].pos = pos;
+}
+
+/* Removes the best candidate from the max-heap of size elements
+return	the candidate
+*/
+static CANDIDATE _popCandidate(CANDIDATE heap[], int size)
+{
+	CANDIDATE top = heap[0];
+	CANDIDATE last = heap[--size];
+	int i = 0;
+
+	for (;;)
+	{
+		int child = 2 * i + 1;
+		if (child >= size)
+			break;
+
+		if (child + 1 < size && _better(heap[child + 1].score, heap[child + 1].index, heap[child].score, heap[child].index))
+			child++;
+
+		if (!_better(heap[child].score, heap[child].index, last.score, last.index))
+			break;
+
+		heap[i] = heap[child];
+		i = child;
+	}
+
+	heap[i] = last;
+
+	return top;
+}
+
+/* Finds the k best entries starting with str (as prefix) by score
+subtrees are visited best first by the score of their best entry (from trieScoresCreate),
+so only the subtrees on the way to the k results are opened, however many entries match
+results receives the indices in dictionary, best first (smaller index on ties)
+return	number of results (at most k)
+-1 overflow
+*/
+int trieTopK(TRIE *root, TRIE_SCORES *scores, char *str, DICT *dic, int k, int results[])
+{
+	int pos = 0;
+	TRIE *node = _prefixNodeAt(root, str, scores, &pos);
+	if (node == NULL || scores->best[pos] == -1 || k <= 0)
+		return 0;
+
+	int capacity = 64, size = 0, count = 0;
+	CANDIDATE *heap = (CANDIDATE *)malloc(capacity * sizeof(CANDIDATE));
+	if (heap == NULL)
+		return -1;
+
+	_pushCandidate(heap, size++, dic->scores[scores->best[pos]], scores->best[pos], node, pos);
+
+	while (size > 0 && count < k)
+	{
+		CANDIDATE top = _popCandidate(heap, size--);
+
+		if (top.node == NULL)
+		{
+			results[count++] = top.index;
+			continue;
+		}
+
+		// the entry of the node and all of its subtrees
+		if (size + 1 + _degree(top.node) > capacity)
+		{
+			capacity = 2 * capacity + _degree(top.node);
+			CANDIDATE *temp = (CANDIDATE *)realloc(heap, capacity * sizeof(CANDIDATE));
+			if (temp == NULL)
+			{
+				free(heap);
+				return -1;
+			}
+			heap = temp;
+		}
+
+		if (top.node->index != -1)
+			_pushCandidate(heap, size++, dic->scores[top.node->index], top.node->index, NULL, 0);
+
+		// every subtree holds an entry, so best is never -1 here
+		int p = top.pos + 1;
+		for (int i = 0; i < _degree(top.node); i++)
+		{
+			int best = scores->best[p];
+			_pushCandidate(heap, size++, dic->scores[best], best, top.node->subtrees[i], p);
+			p += scores->nodes[p];
+		}
+	}
+
+	free(heap);
+
+	return count;
+}
+
+/* prints the k best entries starting with str (as prefix) with their scores
+using trieTopK function
+*/
+void triePrefixTopK(TRIE *root, TRIE_SCORES *scores, char *str, DICT *dic, int k)
+{
+	int *results = (int *)malloc(k * sizeof(int));
+	int count = (results != NULL) ? trieTopK(root, scores, str, dic, k, results) : -1;
+
+	if (count < 0)
+		fprintf(stderr, "Memory allocation error!\n");
+
+	for (int i = 0; i < count; i++)
+		printf("%s %d\n", dictWord(dic, results[i]), dic->scores[results[i]]);
+
+	free(results);
+}
+
+// a key looked up by trieSearchBatch
+typedef struct
+{
+	char *key;
+	int *result; // where the index of the key is stored
+} PROBE;
+
+static int _compareProbes(const void *a, const void *b)
+{
+	return strcmp(((const PROBE *)a)->key, ((const PROBE *)b)->key);
+}
+
+/* Retrieve trie for n keys at once
+the keys are sorted so that each key continues from the nodes of the common prefix
+with the previous key instead of starting at the root
+results[i] receives the index in dictionary of keys[i] or -1 if not found
+return	1 success
+0 overflow
+*/
+int trieSearchBatch(TRIE *root, char *keys[], int results[], int n)
+{
+	if (n <= 0)
+		return 1;
+
+	PROBE *probes = (PROBE *)malloc(n * sizeof(PROBE));
+	if (probes == NULL)
+		return 0;
+
+	int maxLength = 0;
+	for (int i = 0; i < n; i++)
+	{
+		int length = strlen(keys[i]);
+		if (length > maxLength)
+			maxLength = length;
+
+		probes[i].key = keys[i];
+		probes[i].result = &results[i];
+	}
+
+	// path[0 .. top] are the nodes on the path of the previous key,
+	// reached by its first depths[0 .. top] characters
+	TRIE **path = (TRIE **)malloc((maxLength + 1) * sizeof(TRIE *));
+	int *depths = (int *)malloc((maxLength + 1) * sizeof(int));
+	if (path == NULL || depths == NULL)
+	{
+		free(path);
+		free(depths);
+		free(probes);
+		return 0;
+	}
+
+	qsort(probes, n, sizeof(PROBE), _compareProbes);
+
+	char *prev = "";
+	int top = 0;
+	path[0] = root;
+	depths[0] = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		char *str = probes[i].key;
+		int common = 0;
+
+		while (str[common] != '\0' && str[common] == prev[common])
+			common++;
+
+		// keep the nodes reached within the common prefix
+		while (depths[top] > common)
+			top--;
+
+		TRIE *node = path[top];
+		int d = depths[top];
+
+		while (node != NULL && str[d] != '\0')
+		{
+			int length;
+
+			node = _step(node, str + d, &length);
+			if (node != NULL)
+			{
+				d += length;
+				path[++top] = node;
+				depths[top] = d;
+			}
+		}
+
+		prev = str;
+
+		*probes[i].result = (node != NULL) ? node->index : -1;
+	}
+
+	free(path);
+	free(depths);
+	free(probes);
+
+	return 1;
+}
+
+/* Reads all words of the file into a dictionary
+return	dictionary pointer
+NULL if overflow
+*/
+static DICT *_readDict(FILE *fp)
+{
+	char str[MAX_WORD];
+	int length;
+
+	DICT *dic = dictCreate(0);
+	if (dic == NULL)
+		return NULL;
+
+	while ((length = _readWord(fp, str, sizeof(str))) >= 0)
+		if (!dictAdd(dic, str, length, 0))
+		{
+			dictDestroy(dic);
+			return NULL;
+		}
+
+	return dic;
+}
+
+/* returns 1 if the only '*' of str is its last character ("abc*")
+*/
+static int _isPrefixQuery(char *str)
+{
+	int length = strlen(str);
+
+	return length > 0 && strchr(str, '*') == &str[length - 1];
+}
+
+void trieSearchWildcard(TRIE *root, char *str, DICT *dic);
+
+/* Answers all queries of the file at once (main buffers stdout fully for this)
+keyword queries are looked up together by trieSearchBatch;
+prefix queries list only the k best entries if scores are given;
+results are printed in the order of the file
+return	1 success
+0 overflow
+*/
+int trieBatchQuery(TRIE *root, TRIE *permute, FILE *fp, DICT *dic, TRIE_SCORES *scores, int k)
+{
+	DICT *words = _readDict(fp);
+	if (words == NULL)
+		return 0;
+
+	int n = words->n;
+	char **queries = (char **)malloc((n + 1) * sizeof(char *));
+	int *results = (int *)malloc((n + 1) * sizeof(int));
+
+	for (int i = 0; i < n && queries != NULL; i++)
+		queries[i] = dictWord(words, i);
+
+	int ret = (queries != NULL) && (results != NULL) && trieSearchBatch(root, queries, results, n);
+
+	if (ret)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			// wildcard search
+			if (_isPrefixQuery(queries[i]))
+			{
+				queries[i][strlen(queries[i]) - 1] = 0;
+				if (scores != NULL)
+					triePrefixTopK(root, scores, queries[i], dic, k);
+				else
+					triePrefixList(root, queries[i], dic);
+			}
+			else if (strchr(queries[i], '*') != NULL)
+				trieSearchWildcard(permute, queries[i], dic);
+			// keyword search
+			else if (results[i] == -1)
+				printf("[%s] not found!\n", queries[i]);
+			else
+				printf("[%s] found!\n", dictWord(dic, results[i]));
+		}
+	}
+
+	dictDestroy(words);
+	free(queries);
+	free(results);
+
+	return ret;
+}
+
+/* recycles memory for permuterms
+*/
+void clear_permuterms(char *permuterms[], int size)
+{
+	for (int i = 0; i < size; i++)
+	{
+		free(permuterms[i]);
+		permuterms[i] = NULL;
+	}
+}
+
+/* makes permuterms for given str
+ex) "abc" -> "abc$", "bc$a", "c$ab", "$abc"
+return	number of permuterms
+0 if overflow
+*/
+int make_permuterms(char *str, char *permuterms[])
+{
+	int length = strlen(str);
+
+	for (int i = 0; i <= length; i++)
+	{
+		permuterms[i] = (char *)malloc(length + 2);
+		if (permuterms[i] == NULL)
+		{
+			clear_permuterms(permuterms, i);
+			return 0;
+		}
+
+		// rotation of str + EOW starting at str[i]
+		memcpy(permuterms[i], str + i, length - i);
+		permuterms[i][length - i] = EOW;
+		memcpy(permuterms[i] + length - i + 1, str, i);
+		permuterms[i][length + 1] = '\0';
+	}
+
+	return length + 1;
+}
+
+/* Inserts all permuterms of str into the permuterm trie
+return	1 success
+0 failure
+*/
+int trieInsertPermuterms(TRIE *permute, char *str, int dic_index)
+{
+	char *permuterms[MAX_WORD + 1];
+	int size;
+
+	if (strlen(str) >= MAX_WORD || (size = make_permuterms(str, permuterms)) == 0)
+		return 0;
+
+	int ret = 1;
+	for (int i = 0; i < size && ret; i++)
+		ret = trieInsert(permute, permuterms[i], dic_index);
+
+	clear_permuterms(permuterms, size);
+
+	return ret;
+}
+
+/* Collects indices of all entries in trie into a growable array
+return	1 success
+0 overflow
+*/
+static int _collect(TRIE *root, int **indices, int *size, int *capacity)
+{
+	if (root == NULL)
+		return 1;
+
+	if (root->index != -1)
+	{
+		if (*size == *capacity)
+		{
+			int newCapacity = *capacity ? *capacity * 2 : 64;
+			int *temp = (int *)realloc(*indices, newCapacity * sizeof(int));
+			if (temp == NULL)
+				return 0;
+
+			*indices = temp;
+			*capacity = newCapacity;
+		}
+
+		(*indices)[(*size)++] = root->index;
+	}
+
+	for (int i = 0; i < _degree(root); i++)
+		if (!_collect(root->subtrees[i], indices, size, capacity))
+			return 0;
+
+	return 1;
+}
+
+/* returns 1 if word matches pattern, where '*' matches any string
+*/
+static int _match(const char *pattern, const char *word)
+{
+	const char *star = NULL, *retry = NULL;
+
+	while (*word != '\0')
+	{
+		if (*pattern == '*')
+		{
+			star = pattern++;
+			retry = word;
+		}
+		else if (*pattern == *word)
+		{
+			pattern++;
+			word++;
+		}
+		// let the last star swallow one more character
+		else if (star != NULL)
+		{
+			pattern = star + 1;
+			word = ++retry;
+		}
+		else
+			return 0;
+	}
+
+	while (*pattern == '*')
+		pattern++;
+
+	return *pattern == '\0';
+}
+
+static int _compareIndices(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/* Makes the permuterm key for the wildcard pattern str
+with X before the first '*' and Y after the last '*', permuterms starting
+with "Y$X" are exactly the words beginning with X and ending with Y;
+"*X*" uses the permuterms starting with X instead
+key needs room for strlen(str) + 2 characters
+return	1 if the words found must still be matched against str (other stars)
+0 otherwise
+*/
+static int _permutermKey(char *str, char *key)
+{
+	int length = strlen(str);
+	char *first = strchr(str, '*'), *last = strrchr(str, '*');
+
+	int stars = 0;
+	for (char *p = str; *p != '\0'; p++)
+		stars += (*p == '*');
+
+	if (first == NULL)
+	{
+		// no star: "$str" and an exact match
+		sprintf(key, "%c%s", EOW, str);
+		return 1;
+	}
+
+	if (first == str && last == str + length - 1 && stars == 2)
+	{
+		// "*X*"
+		memcpy(key, str + 1, length - 2);
+		key[length - 2] = '\0';
+		return 0;
+	}
+
+	int x = first - str, y = str + length - 1 - last;
+
+	memcpy(key, last + 1, y);
+	key[y] = EOW;
+	memcpy(key + y + 1, str, x);
+	key[x + y + 1] = '\0';
+
+	return stars > 1;
+}
+
+/* Sorts indices[0 .. size), removes duplicates and (if filter) words not matching str
+return	number of indices left
+*/
+static int _uniqueMatches(int indices[], int size, char *str, DICT *dic, int filter)
+{
+	// indices is NULL when nothing was collected
+	if (size == 0)
+		return 0;
+
+	qsort(indices, size, sizeof(int), _compareIndices);
+
+	int n = 0;
+	for (int i = 0; i < size; i++)
+	{
+		if (n > 0 && indices[n - 1] == indices[i])
+			continue;
+
+		if (filter && !_match(str, dictWord(dic, indices[i])))
+			continue;
+
+		indices[n++] = indices[i];
+	}
+
+	return n;
+}
+
+/* Finds dictionary indices of all entries matching the wildcard pattern str
+one prefix walk of the permuterm trie by _permutermKey;
+other stars are checked on the words afterwards
+indices receives the sorted indices without duplicates (freed by caller)
+return	number of indices
+-1 if overflow
+*/
+int trieWildcardIndices(TRIE *permute, char *str, DICT *dic, int **indices)
+{
+	char *key = (char *)malloc(strlen(str) + 2);
+
+	*indices = NULL;
+	if (key == NULL)
+		return -1;
+
+	int filter = _permutermKey(str, key);
+
+	int size = 0, capacity = 0;
+	int ret = _collect(_prefixNode(permute, key), indices, &size, &capacity);
+	free(key);
+
+	if (!ret)
+	{
+		free(*indices);
+		*indices = NULL;
+		return -1;
+	}
+
+	return _uniqueMatches(*indices, size, str, dic, filter);
+}
+
+/* wildcard search
+ex) "ab*", "*ab", "a*b", "*ab*"
+using the permuterm trie (root), each entry printed once
+*/
+void trieSearchWildcard(TRIE *root, char *str, DICT *dic)
+{
+	int *indices;
+	int n = trieWildcardIndices(root, str, dic, &indices);
+
+	for (int i = 0; i < n; i++)
+		printf("%s\n", dictWord(dic, indices[i]));
+
+	free(indices);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DATRIE: read-only double-array form of a TRIE
+// the child of state s by character x is t = base[s] + getIndex(x) + 1 if check[t] == s;
+// state 1 is the root, check[t] == 0 marks a free slot
+#define DA_ROOT 1
+#define DA_MAGIC "DATRIE1"
+
+typedef struct
+{
+	int *base;
+	int *check;
+	int *value; // index in dictionary; -1 (non-word)
+	int size;	// number of slots
+
+	int firstFree; // used while building
+} DATRIE;
+
+// dictionary with the double-array trie and permuterm trie, as stored in a file
+typedef struct
+{
+	DATRIE trie;
+	DATRIE permute;
+	DICT dic; // blob and offsets point into the mapping
+
+	void *map; // mmapped file
+	size_t mapSize;
+} DA_DICT;
+
+// file header, followed by offsets[n], the blob of the words and the arrays of both tries
+typedef struct
+{
+	char magic[8];
+	int n;
+	int blobSize; // bytes of the words (rounded up to sizeof(int))
+	int trieSize;
+	int permuteSize;
+} DA_HEADER;
+
+/* Makes room for slots up to index
+return	1 success
+0 overflow
+*/
+static int _daReserve(DATRIE *da, int index)
+{
+	if (index < da->size)
+		return 1;
+
+	int size = da->size;
+	while (size <= index)
+		size *= 2;
+
+	int *base = (int *)realloc(da->base, size * sizeof(int));
+	if (base != NULL)
+		da->base = base;
+	int *check = (int *)realloc(da->check, size * sizeof(int));
+	if (check != NULL)
+		da->check = check;
+	int *value = (int *)realloc(da->value, size * sizeof(int));
+	if (value != NULL)
+		da->value = value;
+
+	if (base == NULL || check == NULL || value == NULL)
+		return 0;
+
+	for (int i = da->size; i < size; i++)
+	{
+		da->base[i] = da->check[i] = 0;
+		da->value[i] = -1;
+	}
+	da->size = size;
+
+	return 1;
+}
+
+/* Places the children of the trie position (node, k) below state
+k characters of the label of node are consumed (always 0 without RADIX)
+return	1 success
+0 overflow
+*/
+static int _daPlace(DATRIE *da, TRIE *node, int k, int state)
+{
+	int codes[MAX_DEGREE];
+	TRIE *targets[MAX_DEGREE];
+	int m = 0;
+
+#if !RADIX
+	(void)k;
+#else
+	if (k < node->length)
+	{
+		// inside a label: one child
+		codes[m] = getIndex(node->label[k]) + 1;
+		targets[m++] = node;
+	}
+	else
+#endif
+	{
+		da->value[state] = node->index;
+
+		for (int i = 0, j = 0; i < MAX_DEGREE; i++)
+			if (node->bitmap & (1u << i))
+			{
+				codes[m] = i + 1;
+				targets[m++] = node->subtrees[j++];
+			}
+	}
+
+	if (m == 0)
+		return 1;
+
+	// first base at which all children fit into free slots
+	int base = da->firstFree - codes[0];
+	if (base < 1)
+		base = 1;
+
+	for (;; base++)
+	{
+		if (!_daReserve(da, base + MAX_DEGREE))
+			return 0;
+
+		int i = 0;
+		while (i < m && da->check[base + codes[i]] == 0)
+			i++;
+
+		if (i == m)
+			break;
+	}
+
+	da->base[state] = base;
+	for (int i = 0; i < m; i++)
+		da->check[base + codes[i]] = state;
+
+	while (da->firstFree < da->size && da->check[da->firstFree] != 0)
+		da->firstFree++;
+
+	for (int i = 0; i < m; i++)
+	{
+#if RADIX
+		int next = (targets[i] == node) ? k + 1 : 1;
+#else
+		int next = 0;
+#endif
+		if (!_daPlace(da, targets[i], next, base + codes[i]))
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Recycles memory of a double-array trie built by daBuild
+*/
+void daDestroy(DATRIE *da)
+{
+	free(da->base);
+	free(da->check);
+	free(da->value);
+	da->base = da->check = da->value = NULL;
+	da->size = 0;
+}
+
+/* Converts trie into a double-array trie
+return	1 success
+0 overflow
+*/
+int daBuild(TRIE *root, DATRIE *da)
+{
+	da->base = da->check = da->value = NULL;
+	da->size = 0;
+
+	int size = 1024;
+	da->base = (int *)calloc(size, sizeof(int));
+	da->check = (int *)calloc(size, sizeof(int));
+	da->value = (int *)malloc(size * sizeof(int));
+	if (da->base == NULL || da->check == NULL || da->value == NULL)
+	{
+		daDestroy(da);
+		return 0;
+	}
+
+	for (int i = 0; i < size; i++)
+		da->value[i] = -1;
+	da->size = size;
+
+	da->check[DA_ROOT] = -1; // used, but the child of no state
+	da->firstFree = DA_ROOT + 1;
+
+	if (!_daPlace(da, root, 0, DA_ROOT))
+	{
+		daDestroy(da);
+		return 0;
+	}
+
+	// drop the free slots at the end
+	while (da->size > DA_ROOT + 1 && da->check[da->size - 1] == 0)
+		da->size--;
+
+	return 1;
+}
+
+/* returns the child of state by code (getIndex + 1)
+0 if there is none
+*/
+static inline int _daSlot(DATRIE *da, int state, int code)
+{
+	int t = da->base[state] + code;
+	if (t < 0 || t >= da->size || da->check[t] != state)
+		return 0;
+
+	return t;
+}
+
+/* returns the state reached from state by character x
+0 if there is none
+*/
+static inline int _daChild(DATRIE *da, int state, char x)
+{
+	int index = getIndex(x);
+	if (index < 0 || index > MAX_DEGREE - 1)
+		return 0;
+
+	return _daSlot(da, state, index + 1);
+}
+
+/* returns the state reached by str from the root
+0 if there is none
+*/
+static int _daPrefixState(DATRIE *da, char *str)
+{
+	int state = DA_ROOT;
+
+	for (; *str != '\0' && state != 0; str++)
+		state = _daChild(da, state, *str);
+
+	return state;
+}
+
+/* Retrieve double-array trie for the requested key
+return	index in dictionary if key found
+-1 key not found
+*/
+int daSearch(DATRIE *da, char *str)
+{
+	int state = _daPrefixState(da, str);
+
+	return (state != 0) ? da->value[state] : -1;
+}
+
+/* prints all entries below state using preorder traversal
+(in the same order as trieList)
+*/
+static void _daList(DATRIE *da, int state, DICT *dic)
+{
+	if (da->value[state] != -1)
+		printf("%s\n", dictWord(dic, da->value[state]));
+
+	for (int i = 1; i <= MAX_DEGREE; i++)
+	{
+		int t = _daSlot(da, state, i);
+		if (t != 0)
+			_daList(da, t, dic);
+	}
+}
+
+/* prints all entries starting with str (as prefix) in double-array trie
+*/
+void daPrefixList(DATRIE *da, char *str, DICT *dic)
+{
+	int state = _daPrefixState(da, str);
+
+	if (state != 0)
+		_daList(da, state, dic);
+}
+
+/* Collects indices of all entries below state into a growable array
+return	1 success
+0 overflow
+*/
+static int _daCollect(DATRIE *da, int state, int **indices, int *size, int *capacity)
+{
+	if (da->value[state] != -1)
+	{
+		if (*size == *capacity)
+		{
+			int newCapacity = *capacity ? *capacity * 2 : 64;
+			int *temp = (int *)realloc(*indices, newCapacity * sizeof(int));
+			if (temp == NULL)
+				return 0;
+
+			*indices = temp;
+			*capacity = newCapacity;
+		}
+
+		(*indices)[(*size)++] = da->value[state];
+	}
+
+	for (int i = 1; i <= MAX_DEGREE; i++)
+	{
+		int t = _daSlot(da, state, i);
+		if (t != 0 && !_daCollect(da, t, indices, size, capacity))
+			return 0;
+	}
+
+	return 1;
+}
+
+/* wildcard search with the double-array permuterm trie
+(same results as trieSearchWildcard)
+*/
+void daSearchWildcard(DATRIE *permute, char *str, DICT *dic)
+{
+	char *key = (char *)malloc(strlen(str) + 2);
+	if (key == NULL)
+		return;
+
+	int filter = _permutermKey(str, key);
+	int state = _daPrefixState(permute, key);
+	free(key);
+
+	int *indices = NULL;
+	int size = 0, capacity = 0;
+
+	if (state != 0 && _daCollect(permute, state, &indices, &size, &capacity))
+	{
+		int n = _uniqueMatches(indices, size, str, dic, filter);
+
+		for (int i = 0; i < n; i++)
+			printf("%s\n", dictWord(dic, indices[i]));
+	}
+
+	free(indices);
+}
+
+/* Writes the dictionary and both double-array tries to a file
+return	1 success
+0 failure
+*/
+int daSave(char *path, DATRIE *trie, DATRIE *permute, DICT *dic)
+{
+	int padding = (sizeof(int) - dic->blobSize % sizeof(int)) % sizeof(int);
+	DA_HEADER header = {DA_MAGIC, dic->n, dic->blobSize + padding, trie->size, permute->size};
+
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL)
+		return 0;
+
+	int ret = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+			  fwrite(dic->offsets, sizeof(int), dic->n, fp) == (size_t)dic->n &&
+			  fwrite(dic->blob, 1, dic->blobSize, fp) == (size_t)dic->blobSize &&
+			  fwrite("\0\0\0", 1, padding, fp) == (size_t)padding;
+
+	DATRIE *das[2] = {trie, permute};
+	for (int i = 0; i < 2 && ret; i++)
+		ret = fwrite(das[i]->base, sizeof(int), das[i]->size, fp) == (size_t)das[i]->size &&
+			  fwrite(das[i]->check, sizeof(int), das[i]->size, fp) == (size_t)das[i]->size &&
+			  fwrite(das[i]->value, sizeof(int), das[i]->size, fp) == (size_t)das[i]->size;
+
+	return (fclose(fp) == 0) && ret;
+}
+
+/* Checks a mapped double-array trie before it is used
+every base and check must point into the arrays, every value into the n words,
+and following check[] from every used slot must lead to the root (no cycles)
+return	1 valid
+0 corrupted or overflow
+*/
+static int _daValid(DATRIE *da, int n)
+{
+	if (da->size <= DA_ROOT || da->check[DA_ROOT] != -1)
+		return 0;
+
+	for (int t = 0; t < da->size; t++)
+		if (da->base[t] < 0 || da->base[t] >= da->size || da->value[t] < -1 || da->value[t] >= n ||
+			(t != DA_ROOT && (da->check[t] < 0 || da->check[t] >= da->size)))
+			return 0;
+
+	// 1 on the chain being followed, 2 known to lead to the root
+	char *mark = (char *)calloc(da->size, 1);
+	if (mark == NULL)
+		return 0;
+
+	mark[DA_ROOT] = 2;
+
+	int ret = 1;
+	for (int t = 0; t < da->size && ret; t++)
+	{
+		if (da->check[t] == 0)
+			continue; // free slot
+
+		int s = t;
+		while (mark[s] == 0)
+		{
+			mark[s] = 1;
+			s = da->check[s];
+		}
+
+		ret = (mark[s] == 2);
+		for (s = t; mark[s] == 1; s = da->check[s])
+			mark[s] = 2;
+	}
+
+	free(mark);
+
+	return ret;
+}
+
+/* Maps a file written by daSave into memory
+nothing is allocated; the dictionary and both tries are read from the mapping
+the file is checked so that no lookup reads outside of it
+return	1 success
+0 failure
+*/
+int daLoad(char *path, DA_DICT *dict)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(DA_HEADER))
+	{
+		close(fd);
+		return 0;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+
+	DA_HEADER *header = (DA_HEADER *)map;
+	int valid = header->n >= 0 && header->blobSize >= 0 && header->trieSize >= 0 && header->permuteSize >= 0;
+	size_t expected = sizeof(DA_HEADER) + (size_t)header->n * sizeof(int) + header->blobSize +
+					  3 * sizeof(int) * ((size_t)header->trieSize + header->permuteSize);
+
+	if (memcmp(header->magic, DA_MAGIC, sizeof(DA_MAGIC)) != 0 || !valid || expected != (size_t)st.st_size)
+	{
+		munmap(map, st.st_size);
+		return 0;
+	}
+
+	int *offsets = (int *)(header + 1);
+	char *blob = (char *)(offsets + header->n);
+	int *arrays = (int *)(blob + header->blobSize);
+
+	dict->dic.blob = blob;
+	dict->dic.offsets = offsets;
+	dict->dic.scores = NULL;
+	dict->dic.n = dict->dic.capacity = header->n;
+	dict->dic.blobSize = dict->dic.blobCapacity = header->blobSize;
+
+	DATRIE *das[2] = {&dict->trie, &dict->permute};
+	int sizes[2] = {header->trieSize, header->permuteSize};
+	for (int i = 0; i < 2; i++)
+	{
+		das[i]->size = sizes[i];
+		das[i]->base = arrays;
+		das[i]->check = arrays + sizes[i];
+		das[i]->value = arrays + 2 * sizes[i];
+		arrays += 3 * sizes[i];
+	}
+
+	// every word must end inside the blob
+	valid = header->n == 0 || (header->blobSize > 0 && blob[header->blobSize - 1] == '\0');
+	for (int i = 0; i < header->n && valid; i++)
+		valid = offsets[i] >= 0 && offsets[i] < header->blobSize;
+
+	if (!valid || !_daValid(&dict->trie, header->n) || !_daValid(&dict->permute, header->n))
+	{
+		munmap(map, st.st_size);
+		return 0;
+	}
+
+	dict->map = map;
+	dict->mapSize = st.st_size;
+
+	return 1;
+}
+
+/* Unmaps a file loaded by daLoad
+*/
+void daUnload(DA_DICT *dict)
+{
+	munmap(dict->map, dict->mapSize);
+}
+
+/* Answers the queries read from fp with the double-array tries
+prompts are printed only for interactive queries (stdin)
+*/
+void daQuery(DA_DICT *dict, FILE *fp)
+{
+	char str[MAX_WORD];
+	int prompt = (fp == stdin);
+
+	if (prompt)
+		fprintf(stdout, "\nQuery: ");
+
+	while (_readWord(fp, str, sizeof(str)) >= 0)
+	{
+		// wildcard search
+		if (_isPrefixQuery(str))
+		{
+			str[strlen(str) - 1] = 0;
+			daPrefixList(&dict->trie, str, &dict->dic);
+		}
+		else if (strchr(str, '*') != NULL)
+			daSearchWildcard(&dict->permute, str, &dict->dic);
+		// keyword search
+		else
+		{
+			int ret = daSearch(&dict->trie, str);
+			if (ret == -1)
+				printf("[%s] not found!\n", str);
+			else
+				printf("[%s] found!\n", dictWord(&dict->dic, ret));
+		}
+
+		if (prompt)
+			fprintf(stdout, "\nQuery: ");
+	}
+}
+
+#if BENCHMARK
+/* Times wildcard search with the permuterm trie against matching every word of the dictionary
+patterns of each shape are made from random words of the dictionary
+*/
+static void _wildcardBenchmark(TRIE *permute, DICT *dic)
+{
+	int n = dic->n;
+	const int nPatterns = 2000;
+	char (*patterns)[100] = malloc(nPatterns * sizeof(*patterns));
+	if (patterns == NULL || n == 0)
+	{
+		free(patterns);
+		return;
+	}
+
+	srand(n);
+	for (int i = 0; i < nPatterns; i++)
+	{
+		char *word = dictWord(dic, rand() % n);
+		int length = strlen(word);
+		int k = (length < 3) ? length : 3;
+
+		switch (i % 5)
+		{
+		case 0: // X*
+			sprintf(patterns[i], "%.*s*", k, word);
+			break;
+		case 1: // *Y
+			sprintf(patterns[i], "*%s", word + length - k);
+			break;
+		case 2: // X*Y
+			sprintf(patterns[i], "%.1s*%s", word, word + length - (k < 2 ? k : 2));
+			break;
+		case 3: // *X*
+			sprintf(patterns[i], "*%.*s*", k, word + length / 2 - k / 2);
+			break;
+		default: // X*Y*Z
+			sprintf(patterns[i], "%.1s*%.1s*%.1s", word, word + length / 2, word + length - 1);
+			break;
+		}
+	}
+
+	long found = 0, scanned = 0;
+
+	clock_t start = clock();
+	for (int i = 0; i < nPatterns; i++)
+	{
+		int *indices;
+		found += trieWildcardIndices(permute, patterns[i], dic, &indices);
+		free(indices);
+	}
+
+	clock_t middle = clock();
+	for (int i = 0; i < nPatterns; i++)
+		for (int j = 0; j < n; j++)
+			scanned += _match(patterns[i], dictWord(dic, j));
+
+	clock_t end = clock();
+
+	printf("%d patterns, %ld matches (scan: %ld)\n", nPatterns, found, scanned);
+	printf("permuterm %8.3f ms/query  scan %8.3f ms/query\n",
+		   1000.0 * (middle - start) / CLOCKS_PER_SEC / nPatterns,
+		   1000.0 * (end - middle) / CLOCKS_PER_SEC / nPatterns);
+
+	free(patterns);
+}
+
+/* Times top-10 completion against collecting every entry for all prefixes of one or two letters
+*/
+static void _topKBenchmark(TRIE *root, DICT *dic)
+{
+	TRIE_SCORES *scores = trieScoresCreate(root, dic);
+	if (scores == NULL)
+		return;
+
+	char prefix[3] = "";
+	int results[10];
+	long found = 0, matched = 0;
+	int nPrefixes = 0;
+	clock_t topKTime = 0, listTime = 0;
+
+	for (int i = 0; i < 26; i++)
+		for (int j = -1; j < 26; j++)
+		{
+			prefix[0] = 'a' + i;
+			prefix[1] = (j < 0) ? '\0' : 'a' + j;
+			nPrefixes++;
+
+			clock_t start = clock();
+			found += trieTopK(root, scores, prefix, dic, 10, results);
+
+			clock_t middle = clock();
+			int *indices = NULL;
+			int size = 0, capacity = 0;
+			_collect(_prefixNode(root, prefix), &indices, &size, &capacity);
+			matched += size;
+			free(indices);
+
+			clock_t end = clock();
+			topKTime += middle - start;
+			listTime += end - middle;
+		}
+
+	printf("%d prefixes, %ld completions of %ld matches\n", nPrefixes, found, matched);
+	printf("top-10 %8.3f ms/query  all %8.3f ms/query\n",
+		   1000.0 * topKTime / CLOCKS_PER_SEC / nPrefixes,
+		   1000.0 * listTime / CLOCKS_PER_SEC / nPrefixes);
+
+	trieScoresDestroy(scores);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	TRIE *trie;
+	TRIE *permute;
+	int ret;
+	char str[MAX_WORD];
+	FILE *fp;
+	DICT *dic;
+
+	// -o DA_FILE saves double-array tries after loading FILE; -m DA_FILE loads them instead of FILE
+	// -k K lists only the K best entries (by the score after each word of FILE) for prefix queries
+	char *daFile = NULL;
+	int mapped = 0, topK = 0, arg = 1;
+
+	while (argc - arg >= 2 && argv[arg][0] == '-')
+	{
+		if (strcmp(argv[arg], "-o") == 0 || strcmp(argv[arg], "-m") == 0)
+		{
+			mapped = (argv[arg][1] == 'm');
+			daFile = argv[arg + 1];
+		}
+		else if (strcmp(argv[arg], "-k") == 0 && atoi(argv[arg + 1]) > 0)
+			topK = atoi(argv[arg + 1]);
+		else
+			break;
+
+		arg += 2;
+	}
+
+	if (mapped ? (argc - arg > 1 || topK > 0) : (argc - arg != 1 && argc - arg != 2))
+	{
+		fprintf(stderr, "Usage: %s [-k K] [-o DA_FILE] FILE [QUERY_FILE]\n", argv[0]);
+		fprintf(stderr, "       %s -m DA_FILE [QUERY_FILE]\n", argv[0]);
+		return 1;
+	}
+
+	char *queryFile = (argc - arg == (mapped ? 1 : 2)) ? argv[argc - 1] : NULL;
+
+	// batch results are written in large blocks; setvbuf must come before any output
+	if (queryFile != NULL)
+		setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	if (mapped)
+	{
+		DA_DICT dict;
+
+		if (!daLoad(daFile, &dict))
+		{
+			fprintf(stderr, "File load error: %s\n", daFile);
+			return 1;
+		}
+
+		fp = (queryFile != NULL) ? fopen(queryFile, "rt") : stdin;
+		if (fp == NULL)
+		{
+			fprintf(stderr, "File open error: %s\n", queryFile);
+			daUnload(&dict);
+			return 1;
+		}
+
+		daQuery(&dict, fp);
+
+		if (fp != stdin)
+			fclose(fp);
+		daUnload(&dict);
+
+		return 0;
+	}
+
+	fp = fopen(argv[arg], "rt");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "File open error: %s\n", argv[arg]);
+		return 1;
+	}
+
+	// the words take about as many bytes as the file
+	fseek(fp, 0, SEEK_END);
+	long fileSize = ftell(fp);
+	rewind(fp);
+
+	trie = trieCreateNode();
+	permute = trieCreateNode();
+	dic = dictCreate((fileSize > 0 && fileSize < (1L << 30)) ? (int)fileSize + 1 : 0);
+
+	if (trie == NULL || permute == NULL || dic == NULL)
+	{
+		fprintf(stderr, "Memory allocation error!\n");
+		return 1;
+	}
+
+	int length;
+	while ((length = _readWord(fp, str, sizeof(str))) >= 0)
+	{
+		int score = _readScore(fp);
+		ret = trieInsert(trie, str, dic->n);
+
+		if (ret)
+		{
+			// every rotation of a new word is new, so only overflow fails here;
+			// the tries already refer to word dic->n, so the load cannot go on without it
+			if (!trieInsertPermuterms(permute, str, dic->n) || !dictAdd(dic, str, length, score))
+			{
+				fprintf(stderr, "Memory allocation error!\n");
+				fclose(fp);
+				dictDestroy(dic);
+				trieDestroy(trie);
+				trieDestroy(permute);
+				return 1;
+			}
+		}
+	}
+
+	fclose(fp);
+
+	// only needed for top-K completion
+	TRIE_SCORES *scores = NULL;
+	if (topK > 0 && (scores = trieScoresCreate(trie, dic)) == NULL)
+	{
+		fprintf(stderr, "Memory allocation error!\n");
+		dictDestroy(dic);
+		trieDestroy(trie);
+		trieDestroy(permute);
+		return 1;
+	}
+
+#if MEMORY_REPORT
+	long nodes = 0, bytes = 0;
+	trieMemory(trie, &nodes, &bytes);
+
+	fprintf(stdout, "%d keys, %ld nodes\n", dic->n, nodes);
+#if !RADIX
+	// previous node: index and MAX_DEGREE subtree pointers
+	long fullBytes = nodes * sizeof(struct { int index; TRIE *subtrees[MAX_DEGREE]; });
+
+	fprintf(stdout, "full nodes:    %10ld bytes (%.1f bytes per key)\n", fullBytes, (double)fullBytes / dic->n);
+#endif
+	fprintf(stdout, "compact nodes: %10ld bytes (%.1f bytes per key)\n", bytes, (double)bytes / dic->n);
+
+	nodes = bytes = 0;
+	trieMemory(permute, &nodes, &bytes);
+	fprintf(stdout, "permuterms:    %10ld bytes in %ld nodes\n", bytes, nodes);
+
+	if (scores != NULL)
+		fprintf(stdout, "top-K scores:  %10ld bytes\n", 2L * scores->n * sizeof(int));
+#endif
+
+	if (daFile != NULL)
+	{
+		DATRIE daTrie, daPermute;
+
+		ret = daBuild(trie, &daTrie);
+		if (ret)
+		{
+			ret = daBuild(permute, &daPermute);
+			if (ret)
+			{
+				ret = daSave(daFile, &daTrie, &daPermute, dic);
+				daDestroy(&daPermute);
+			}
+			daDestroy(&daTrie);
+		}
+
+		if (!ret)
+			fprintf(stderr, "File save error: %s\n", daFile);
+	}
+
+#if BENCHMARK
+	_wildcardBenchmark(permute, dic);
+	_topKBenchmark(trie, dic);
+#else
+	// batch search
+	if (queryFile != NULL)
+	{
+		fp = fopen(queryFile, "rt");
+		if (fp == NULL)
+		{
+			fprintf(stderr, "File open error: %s\n", queryFile);
+			return 1;
+		}
+
+		if (!trieBatchQuery(trie, permute, fp, dic, scores, topK))
+			fprintf(stderr, "Batch search error!\n");
+
+		fclose(fp);
+	}
+
+	else
+	{
+		fprintf(stdout, "\nQuery: ");
+		while (_readWord(stdin, str, sizeof(str)) >= 0)
+		{
+			// wildcard search
+			if (_isPrefixQuery(str))
+			{
+				str[strlen(str) - 1] = 0;
+				if (scores != NULL)
+					triePrefixTopK(trie, scores, str, dic, topK);
+				else
+					triePrefixList( trie, str, dic);
+			}
+			else if (strchr(str, '*') != NULL)
+				trieSearchWildcard(permute, str, dic);
+			// keyword search
+			else
+			{
+				ret = trieSearch(trie, str);
+				if (ret == -1)
+					printf("[%s] not found!\n", str);
+				else
+					printf("[%s] found!\n", dictWord(dic, ret));
+			}
+
+			fprintf(stdout, "\nQuery: ");
+		}
+	}
+#endif
 
+	trieScoresDestroy(scores);
+	dictDestroy(dic);
 	trieDestroy(trie);
+	trieDestroy(permute);
 
 	return 0;
 }